@@ -0,0 +1,72 @@
+// Micro-benchmark of the pixel conversion kernels: runs every kernel in its scalar and its dispatched version
+// over the same input, checks that both produce identical output and reports their throughput.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include "pixels/kernels.hpp"
+
+namespace
+{
+    constexpr size_t pixel_count = 1024 * 1024;
+
+    template <typename Run>
+    f64 measure(Run &&run, int repeats)
+    {
+        f64 best = 1e30;
+        for (int i = 0; i < repeats; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // Returns false if the outputs of both versions differ
+    template <typename Src, typename Dst, typename Kernel>
+    bool bench(const char *name, const acul::vector<Src> &src, size_t count, size_t dst_size, Kernel scalar,
+               Kernel fast, int repeats)
+    {
+        acul::vector<Dst> expected(dst_size), actual(dst_size);
+        const f64 scalar_time = measure([&] { scalar(src.data(), expected.data(), count); }, repeats);
+        const f64 fast_time = measure([&] { fast(src.data(), actual.data(), count); }, repeats);
+        const f64 bytes = static_cast<f64>(src.size() * sizeof(Src));
+        printf("%-16s scalar %8.1f MB/s   %s %8.1f MB/s   x%.2f\n", name, bytes / scalar_time / 1e6,
+               pixels::kernels().name, bytes / fast_time / 1e6, scalar_time / fast_time);
+        if (memcmp(expected.data(), actual.data(), dst_size * sizeof(Dst)) == 0) return true;
+        printf("%s: output differs from the scalar kernel\n", name);
+        return false;
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    // --quick keeps the run short enough for a test
+    const int repeats = argc > 1 && strcmp(argv[1], "--quick") == 0 ? 1 : 20;
+    std::mt19937 random(42);
+    acul::vector<u8> bytes(pixel_count * 4);
+    for (auto &byte : bytes) byte = static_cast<u8>(random());
+    // Covers normal, subnormal, overflowing and special half values
+    acul::vector<f32> floats(pixel_count * 4);
+    std::uniform_real_distribution<f32> exponent(-30.0f, 20.0f);
+    for (auto &value : floats) value = std::ldexp(static_cast<f32>(random()) / 4294967296.0f, exponent(random));
+    floats[0] = 1.0f / 0.0f;
+    floats[1] = -floats[0];
+    floats[2] = std::nanf("");
+
+    const auto &scalar = pixels::scalar_kernels();
+    const auto &fast = pixels::kernels();
+    bool ok = bench<u8, f32>("u8_to_f32", bytes, bytes.size(), bytes.size(), scalar.u8_to_f32, fast.u8_to_f32,
+                             repeats);
+    ok &= bench<u8, u8>("rgb_to_rgba_u8", bytes, pixel_count, pixel_count * 4, scalar.rgb_to_rgba_u8,
+                        fast.rgb_to_rgba_u8, repeats);
+    ok &= bench<f32, f32>("rgb_to_rgba_f32", floats, pixel_count, pixel_count * 4, scalar.rgb_to_rgba_f32,
+                          fast.rgb_to_rgba_f32, repeats);
+    ok &= bench<f32, u16>("f32_to_f16", floats, floats.size(), floats.size(), scalar.f32_to_f16, fast.f32_to_f16,
+                          repeats);
+    return ok ? 0 : 1;
+}
@@ -4,56 +4,35 @@
 #include <acul/log.hpp>
 #include <aecl/image/import.hpp>
 #include <aecl/scene/obj/import.hpp>
+#include <inttypes.h>
+#include <mutex>
 #include <rapidjson/document.h>
+#include <unordered_map>
 #include <umbf/utils.hpp>
 #include <umbf/version.h>
+#include "convert.hpp"
+#include "hash.hpp"
+#include "io/file_info.hpp"
+#include "io/mapped_file.hpp"
+#include "io/prefetch.hpp"
+#include "mesh/optimize.hpp"
+#include "mesh/quantize.hpp"
 #include "models/umbf.hpp"
-
-namespace
-{
-    amal::ivec2 find_min_square_atlas_size(const acul::vector<amal::irect> &rects, i32 padding)
-    {
-        if (rects.empty()) return {1, 1};
-
-        i32 min_side = 1;
-        for (u32 i = 0; i < rects.size(); ++i)
-            min_side = amal::max(min_side, amal::max(rects[i].size.x, rects[i].size.y) + padding * 2);
-
-        i32 max_side = min_side;
-        while (true)
-        {
-            auto probe_rects = rects;
-            const auto result =
-                umbf::utils::pack_max_rects({max_side, max_side}, 0, probe_rects,
-                                            umbf::utils::MaxRectsHeuristic::best_short_side_fit,
-                                            umbf::utils::MaxRectsTransformBits::none, padding);
-            if (result.packed) break;
-
-            if (max_side > (1 << 29)) throw acul::runtime_error("Failed to determine atlas size");
-            max_side *= 2;
-        }
-
-        i32 best_side = max_side;
-        while (min_side <= max_side)
-        {
-            const i32 mid_side = min_side + (max_side - min_side) / 2;
-            auto probe_rects = rects;
-            const auto result =
-                umbf::utils::pack_max_rects({mid_side, mid_side}, 0, probe_rects,
-                                            umbf::utils::MaxRectsHeuristic::best_short_side_fit,
-                                            umbf::utils::MaxRectsTransformBits::none, padding);
-            if (result.packed)
-            {
-                best_side = mid_side;
-                max_side = mid_side - 1;
-            }
-            else
-                min_side = mid_side + 1;
-        }
-
-        return {best_side, best_side};
-    }
-} // namespace
+#include "pipeline.hpp"
+#include "pixels/atlas.hpp"
+#include "pixels/cache.hpp"
+#include "pixels/pack.hpp"
+#include "pixels/probe.hpp"
+#include "pixels/trim.hpp"
+#include "raw/adaptive.hpp"
+#include "raw/aux.hpp"
+#include "raw/borrow.hpp"
+#include "raw/chunked.hpp"
+#include "raw/dedup.hpp"
+#include "raw/dictionary.hpp"
+#include "raw/format.hpp"
+#include "raw/manifest.hpp"
+#include "raw/payload.hpp"
 
 inline void create_file_structure(umbf::File &file, u16 type_sign, u8 flags = 0)
 {
@@ -67,10 +46,11 @@ inline void create_file_structure(umbf::File &file, u16 type_sign, u8 flags = 0)
 namespace
 {
     constexpr int default_compression_level = 5;
+    constexpr u32 mesh_read_ahead = 4; // Mesh files of a JSON scene read ahead of the importer
 
-    bool read_raw_file(const acul::string &input, acul::vector<char> &data)
+    bool open_raw_file(const acul::string &input, io::MappedFile &source)
     {
-        if (!acul::fs::read_binary(input, data))
+        if (!source.open(input))
         {
             LOG_ERROR("Failed to read raw file: %s", input.c_str());
             return false;
@@ -78,85 +58,498 @@ namespace
         return true;
     }
 
-    bool convert_raw_file(const acul::string &input, umbf::File &file)
+    // The source is mapped rather than read, and the block points at the mapping, so its bytes are not copied
+    // at all: the save reads them straight from the page cache.
+    bool convert_raw_file(const acul::string &input, raw::BorrowedBlocks &borrowed, umbf::File &file)
     {
-        acul::vector<char> data;
-        if (!read_raw_file(input, data)) return false;
-        auto block = acul::make_shared<umbf::RawBlock>();
-        block->data = acul::alloc_n<char>(data.size());
-        memcpy(block->data, data.data(), data.size());
-        block->data_size = data.size();
-        file.blocks.push_back(block);
+        io::MappedFile source;
+        if (!open_raw_file(input, source)) return false;
+        file.blocks.push_back(borrowed.borrow(std::move(source)));
         return true;
     }
 
-    umbf::Library::Node *find_or_create_folder(umbf::Library::Node &parent, const acul::string &name)
+    // Folders of the library tree being built, keyed by name. Children are stored by position because the node
+    // vectors reallocate as they grow.
+    struct FolderIndex
+    {
+        struct Folder
+        {
+            size_t position = 0;
+            acul::unique_ptr<FolderIndex> folders;
+        };
+        std::unordered_map<acul::string, Folder, StringHash> folders;
+    };
+
+    umbf::Library::Node *find_or_create_folder(umbf::Library::Node &parent, FolderIndex *&index,
+                                               const acul::string &name)
     {
-        auto it = std::find_if(parent.children.begin(), parent.children.end(),
-                               [&name](const umbf::Library::Node &child) { return child.name == name; });
-        if (it != parent.children.end()) return &(*it);
+        auto [it, inserted] = index->folders.try_emplace(name);
+        if (inserted)
+        {
+            umbf::Library::Node folder;
+            folder.name = name;
+            folder.is_folder = true;
+            it->second.position = parent.children.size();
+            it->second.folders = acul::make_unique<FolderIndex>();
+            parent.children.push_back(std::move(folder));
+        }
+        index = it->second.folders.get();
+        return &parent.children[it->second.position];
+    }
 
-        umbf::Library::Node folder;
-        folder.name = name;
-        folder.is_folder = true;
-        parent.children.push_back(std::move(folder));
-        return &parent.children.back();
+    const umbf::Mapping *find_mapping(const umbf::File &asset)
+    {
+        for (const auto &block : asset.blocks)
+            if (block->signature() == umbf::sign_block::mapping)
+                return static_cast<const umbf::Mapping *>(block.get());
+        return nullptr;
     }
 
-    bool append_mapped_payload(const acul::string &input, bool compressed, umbf::File &asset, acul::vector<char> &payload)
+    struct RawEntry
+    {
+        acul::string source;
+        acul::string relative;
+        acul::string key; // Library path with components joined by '/'
+        io::FileInfo info;
+    };
+
+    struct PreviousEntry
+    {
+        raw::ManifestEntry manifest;
+        const umbf::Library::Node *node = nullptr;
+    };
+
+    // Output of an earlier build that unchanged entries are taken from
+    struct PreviousLibrary
     {
-        acul::vector<char> data;
-        if (!read_raw_file(input, data)) return false;
+        acul::shared_ptr<umbf::File> file;
+        const umbf::RawBlock *payload = nullptr;
+        std::unordered_map<acul::string, PreviousEntry, StringHash> entries;
 
-        acul::vector<char> stored = std::move(data);
-        if (compressed)
+        const PreviousEntry *find(const acul::string &key) const
         {
-            acul::vector<char> compressed_data;
-            auto cr = acul::fs::compress(stored.data(), stored.size(), compressed_data, default_compression_level);
-            if (!cr.success())
+            auto it = entries.find(key);
+            return it != entries.end() && it->second.node ? &it->second : nullptr;
+        }
+    };
+
+    // Every option that changes the stored bytes or their layout, i.e. all but the job count, read-ahead and
+    // spilling, must match for entries to be reused
+    u64 raw_settings(const RawOptions &options)
+    {
+        const acul::string settings = acul::format(
+            "mapped=%d;compressed=%d;level=%d;adaptive=%d;ratio=%.4f;dict=%u;solid=%" PRIu64 ";chunk=%" PRIu64,
+            options.mapped ? 1 : 0, options.compressed ? 1 : 0, default_compression_level, options.adaptive ? 1 : 0,
+            options.adaptive ? options.min_ratio : 0.0f, options.dictionary ? options.dict_size : 0u,
+            options.solid_size, options.chunk_size);
+        return hash_bytes(settings.c_str(), settings.size());
+    }
+
+    void index_previous_nodes(const umbf::Library::Node &node, const acul::string &prefix, PreviousLibrary &previous)
+    {
+        for (const auto &child : node.children)
+        {
+            const acul::string key = prefix.empty() ? child.name : prefix + "/" + child.name;
+            if (child.is_folder)
             {
-                LOG_ERROR("Failed to compress raw file: %s", input.c_str());
-                return false;
+                index_previous_nodes(child, key, previous);
+                continue;
             }
-            stored = std::move(compressed_data);
+            auto it = previous.entries.find(key);
+            if (it == previous.entries.end()) continue;
+            if (previous.payload && !find_mapping(child.asset)) continue;
+            it->second.node = &child;
+        }
+    }
+
+    bool load_previous_library(const acul::string &path, const RawOptions &options, PreviousLibrary &previous)
+    {
+        io::FileInfo info;
+        if (!io::stat_file(path, info))
+        {
+            LOG_INFO("Previous output not found, doing a full build: %s", path.c_str());
+            return false;
+        }
+        auto res = umbf::File::read_from_disk(path, previous.file);
+        if (!res.success())
+        {
+            LOG_WARN("Failed to load previous output, doing a full build: %s", path.c_str());
+            return false;
         }
 
+        raw::Manifest manifest;
+        if (raw::base_type(previous.file->header.type_sign) != umbf::sign_block::format::library ||
+            !raw::read_manifest(*previous.file, manifest))
+        {
+            LOG_WARN("Previous output has no build manifest, doing a full build: %s", path.c_str());
+            return false;
+        }
+        if (manifest.settings != raw_settings(options))
+        {
+            LOG_INFO("Conversion options changed since the previous build, doing a full build");
+            return false;
+        }
+
+        const umbf::Library *library = nullptr;
+        for (const auto &block : previous.file->blocks)
+        {
+            if (block->signature() == umbf::sign_block::library && !library)
+                library = static_cast<const umbf::Library *>(block.get());
+            else if (block->signature() == umbf::sign_block::raw && !previous.payload && options.mapped)
+                previous.payload = static_cast<const umbf::RawBlock *>(block.get());
+        }
+        if (!library || (options.mapped && !previous.payload))
+        {
+            LOG_WARN("Previous output is not a raw library, doing a full build: %s", path.c_str());
+            return false;
+        }
+
+        previous.entries.reserve(manifest.entries.size());
+        for (auto &entry : manifest.entries) previous.entries[entry.path] = {std::move(entry), nullptr};
+        index_previous_nodes(library->file_tree, "", previous);
+        return true;
+    }
+
+    // Result of the parallel stage for one entry: either a ready asset (plain library), the mapped source
+    // and its compressed bytes (mapped library) waiting to be appended to the shared payload, or an unchanged
+    // entry of the previous build.
+    struct PreparedEntry
+    {
+        bool ok = false;
+        umbf::File asset;
+        io::MappedFile source;
+        u64 hash = 0;
+        bool compress_deferred = false;
+        bool stored_compressed = false;
+        acul::vector<char> compressed_data;
+        const PreviousEntry *reused = nullptr;
+    };
+
+    // State shared by the stages of a recursive raw import
+    struct RawBuild
+    {
+        const RawOptions &options;
+        raw::PayloadBuilder payload;
+        raw::PayloadBuilder solid; // Compressed blocks of the payload in solid mode
+        raw::DedupIndex dedup;
+        PreviousLibrary previous;
+        bool incremental = false;
+        raw::Manifest manifest;
+        std::unordered_map<u64, u64> reused_offsets; // Previous payload offset -> new payload offset
+        size_t reused = 0;
+        acul::shared_ptr<raw::Dictionary> dictionary;
+        FolderIndex folders; // Of the library root
+        raw::BorrowedBlocks borrowed; // Sources of a plain library
+
+        explicit RawBuild(const RawOptions &options) : options(options) {}
+    };
+
+    // With adaptive compression, entries that fail the pre-check or do not reach the minimal ratio are stored
+    // as is and marked so in their own header.
+    bool compress_entry(const acul::string &input, const RawBuild &build, PreparedEntry &entry)
+    {
+        const RawOptions &options = build.options;
+        entry.compress_deferred = false;
+        entry.stored_compressed = false;
+        const char *data = entry.source.data();
+        const size_t size = entry.source.size();
+        if (options.adaptive && !raw::worth_compressing(data, size, options.min_ratio, default_compression_level))
+            return true;
+
+        const bool compressed = build.dictionary
+                                    ? build.dictionary->compress(data, size, entry.compressed_data)
+                                    : acul::fs::compress(data, size, entry.compressed_data, default_compression_level)
+                                          .success();
+        if (!compressed)
+        {
+            LOG_ERROR("Failed to compress raw file: %s", input.c_str());
+            return false;
+        }
+        const f32 ratio = size > 0 ? static_cast<f32>(entry.compressed_data.size()) / static_cast<f32>(size) : 1.0f;
+        if (options.adaptive && (ratio > options.min_ratio || entry.compressed_data.size() >= size))
+        {
+            entry.compressed_data.clear();
+            entry.compressed_data.shrink_to_fit();
+            return true;
+        }
+        entry.stored_compressed = true;
+        return true;
+    }
+
+    // Layouts that stock umbf readers would misread are marked, see raw/format.hpp
+    u16 library_type(const RawBuild &build)
+    {
+        const RawOptions &options = build.options;
+        const bool entry_flags = options.mapped && options.compressed && options.adaptive;
+        const bool extended = entry_flags || build.dictionary || options.solid_size > 0;
+        return extended ? raw::extended_type(umbf::sign_block::format::library) : umbf::sign_block::format::library;
+    }
+
+    // Same size and mtime as recorded last time: the previous bytes are taken without touching the source
+    bool is_unmodified(const RawEntry &raw_entry, const PreviousEntry *previous)
+    {
+        return previous && previous->manifest.size == raw_entry.info.size &&
+               previous->manifest.mtime == raw_entry.info.mtime;
+    }
+
+    bool prepare_raw_entry(const RawEntry &raw_entry, RawBuild &build, PreparedEntry &entry)
+    {
+        const PreviousEntry *previous = build.incremental ? build.previous.find(raw_entry.key) : nullptr;
+        if (is_unmodified(raw_entry, previous))
+        {
+            entry.reused = previous;
+            entry.hash = previous->manifest.hash;
+            return true;
+        }
+
+        if (!open_raw_file(raw_entry.source, entry.source)) return false;
+        // The manifest of an incremental build records the hash even when there is no previous output yet
+        if (build.options.mapped || !build.options.incremental.empty())
+            entry.hash = hash_bytes(entry.source.data(), entry.source.size());
+        // Touched but not modified
+        if (previous && previous->manifest.size == entry.source.size() && previous->manifest.hash == entry.hash)
+        {
+            entry.reused = previous;
+            return true;
+        }
+
+        if (!build.options.mapped)
+        {
+            entry.asset.blocks.push_back(build.borrowed.borrow(std::move(entry.source)));
+            return true;
+        }
+        if (!build.options.compressed || build.options.solid_size > 0) return true;
+        // A repeated hash is almost certainly a duplicate that will be aliased, so its compression is left to the
+        // ordered stage, which only runs it if the byte comparison fails.
+        if (build.dedup.mark_seen(entry.hash))
+        {
+            entry.compress_deferred = true;
+            return true;
+        }
+        return compress_entry(raw_entry.source, build, entry);
+    }
+
+    void append_reused_payload(const PreviousEntry &previous, RawBuild &build, const acul::string &input,
+                               umbf::File &asset, umbf::Mapping &mapping)
+    {
+        asset.header.flags = previous.node->asset.header.flags;
+        const umbf::Mapping *old_mapping = find_mapping(previous.node->asset);
+        mapping.size = old_mapping->size;
+        auto [it, inserted] = build.reused_offsets.try_emplace(old_mapping->offset, 0);
+        if (!inserted)
+        {
+            // Was an alias of another entry in the previous build as well
+            mapping.offset = it->second;
+            build.dedup.add_duplicate(mapping.size);
+            return;
+        }
+        mapping.offset = build.payload.append(build.previous.payload->data + old_mapping->offset, old_mapping->size);
+        it->second = mapping.offset;
+        build.dedup.insert(previous.manifest.hash,
+                           {input, previous.manifest.size, mapping.offset, mapping.size, asset.header.flags});
+    }
+
+    bool append_mapped_payload(const acul::string &input, PreparedEntry &entry, RawBuild &build, umbf::File &asset)
+    {
         create_file_structure(asset, umbf::sign_block::format::raw);
         auto mapping = acul::make_shared<umbf::Mapping>();
-        mapping->offset = payload.size();
-        mapping->size = stored.size();
         asset.blocks.push_back(mapping);
-        payload.insert(payload.end(), stored.begin(), stored.end());
+
+        if (entry.reused)
+        {
+            append_reused_payload(*entry.reused, build, input, asset, *mapping);
+            return true;
+        }
+
+        if (auto *slot = build.dedup.find(entry.hash, entry.source.data(), entry.source.size()))
+        {
+            mapping->offset = slot->offset;
+            mapping->size = slot->stored_size;
+            asset.header.flags = slot->flags;
+            build.dedup.add_duplicate(slot->stored_size);
+            return true;
+        }
+
+        if (entry.compress_deferred && !compress_entry(input, build, entry)) return false;
+        const bool compressed = entry.stored_compressed;
+        const char *stored = compressed ? entry.compressed_data.data() : entry.source.data();
+        const size_t stored_size = compressed ? entry.compressed_data.size() : entry.source.size();
+        if (compressed && build.options.adaptive) asset.header.flags = UMBF_COMPRESSION_MAPPED_BIT;
+
+        mapping->offset = build.payload.append(stored, stored_size);
+        mapping->size = stored_size;
+        build.dedup.insert(entry.hash,
+                           {input, entry.source.size(), mapping->offset, mapping->size, asset.header.flags});
         return true;
     }
 
-    bool build_raw_library_node(umbf::Library::Node &root, const acul::path &relative_path, const acul::string &source_path,
-                                bool mapped, bool compressed, acul::vector<char> *payload)
+    bool build_raw_library_node(umbf::Library::Node &root, const RawEntry &raw_entry, PreparedEntry &entry,
+                                RawBuild &build)
     {
+        const acul::path relative_path(raw_entry.relative);
         umbf::Library::Node *current = &root;
+        FolderIndex *folders = &build.folders;
         for (size_t i = 0; i < relative_path.size(); ++i)
         {
             const bool is_leaf = i + 1 == relative_path.size();
             const auto &part = *(relative_path.begin() + static_cast<ptrdiff_t>(i));
             if (!is_leaf)
             {
-                current = find_or_create_folder(*current, part);
+                current = find_or_create_folder(*current, folders, part);
                 continue;
             }
 
             umbf::Library::Node node;
             node.name = part;
             node.is_folder = false;
-            const bool ok = mapped ? append_mapped_payload(source_path, compressed, node.asset, *payload)
-                                   : convert_raw_file(source_path, node.asset);
-            if (!ok) return false;
+            if (build.options.mapped)
+            {
+                if (!append_mapped_payload(raw_entry.source, entry, build, node.asset)) return false;
+            }
+            else if (entry.reused) node.asset = entry.reused->node->asset;
+            else node.asset = std::move(entry.asset);
             current->children.push_back(std::move(node));
         }
+
+        if (entry.reused) ++build.reused;
+        // The source of a plain library has been moved into its block by now, so the size comes from the stat
+        if (!build.options.incremental.empty())
+            build.manifest.entries.push_back({raw_entry.key, raw_entry.info.size, raw_entry.info.mtime, entry.hash});
+        return true;
+    }
+
+    acul::string library_key(const acul::path &relative_path)
+    {
+        acul::string key;
+        for (size_t i = 0; i < relative_path.size(); ++i)
+        {
+            if (i > 0) key += '/';
+            key += *(relative_path.begin() + static_cast<ptrdiff_t>(i));
+        }
+        return key;
+    }
+
+    // Compresses [data, data + size) in independent chunks of chunk_size on the worker pool
+    bool compress_chunks(const char *data, u64 size, u64 chunk_size, u32 jobs, raw::ChunkTable &table,
+                         raw::PayloadBuilder &payload)
+    {
+        table.raw_size = size;
+        table.chunk_size = chunk_size;
+        const size_t count = static_cast<size_t>((size + chunk_size - 1) / chunk_size);
+        table.offsets.clear();
+        table.offsets.reserve(count + 1);
+        struct Chunk
+        {
+            bool ok = false;
+            acul::vector<char> data;
+        };
+        const bool ok = run_ordered<Chunk>(
+            count, jobs,
+            [&](size_t i) {
+                const u64 begin = static_cast<u64>(i) * chunk_size;
+                const u64 chunk = std::min<u64>(chunk_size, size - begin);
+                Chunk result;
+                result.ok = acul::fs::compress(data + begin, chunk, result.data, default_compression_level).success();
+                return result;
+            },
+            [&](size_t i, Chunk &chunk) {
+                if (!chunk.ok)
+                {
+                    LOG_ERROR("Failed to compress chunk %zu", i);
+                    return false;
+                }
+                // Reserving the input size would hold about twice the input while compressing. The payload is
+                // sized from the first chunk instead and grows if later chunks compress worse.
+                if (i == 0) payload.reserve(payload.size() + static_cast<u64>(chunk.data.size()) * count);
+                table.offsets.push_back(payload.append(chunk.data.data(), chunk.data.size()));
+                return true;
+            });
+        if (!ok) return false;
+        table.offsets.push_back(payload.size());
+        return true;
+    }
+
+    constexpr u64 max_dictionary_sample = 128 * 1024;
+
+    // Small entries gain the most from a dictionary and are the ones it is trained on. They are sampled evenly
+    // across the sorted list until roughly a hundred times the dictionary size is collected, which is what the
+    // zstd trainer recommends.
+    bool train_dictionary(const acul::vector<RawEntry> &entries, const RawOptions &options,
+                          raw::Dictionary &dictionary)
+    {
+        acul::vector<size_t> candidates;
+        u64 candidates_size = 0;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            const u64 size = entries[i].info.size;
+            if (size == 0 || size > max_dictionary_sample) continue;
+            candidates.push_back(i);
+            candidates_size += size;
+        }
+
+        const u64 budget = static_cast<u64>(options.dict_size) * 100;
+        const size_t stride =
+            candidates_size > budget ? static_cast<size_t>((candidates_size + budget - 1) / budget) : 1;
+        acul::vector<char> samples;
+        acul::vector<size_t> sizes;
+        for (size_t i = 0; i < candidates.size(); i += stride)
+        {
+            io::MappedFile source;
+            if (!source.open(entries[candidates[i]].source)) continue;
+            samples.insert(samples.end(), source.data(), source.data() + source.size());
+            sizes.push_back(source.size());
+        }
+        if (sizes.size() < 8)
+        {
+            LOG_WARN("Too few small entries to train a dictionary, compressing without it");
+            return false;
+        }
+        if (!dictionary.train(samples, sizes, options.dict_size, default_compression_level))
+        {
+            LOG_WARN("Failed to train a dictionary, compressing without it");
+            return false;
+        }
+        LOG_INFO("Trained a %zu byte dictionary on %zu entries", dictionary.data().size(), sizes.size());
         return true;
     }
 
-    bool convert_raw_directory(const acul::string &input, bool compressed, bool mapped, umbf::File &file)
+    // An incremental build keeps the dictionary of the previous output, otherwise the entries taken from it
+    // could no longer be decompressed.
+    void prepare_dictionary(const acul::vector<RawEntry> &entries, RawBuild &build)
     {
+        auto dictionary = acul::make_shared<raw::Dictionary>();
+        if (build.incremental)
+        {
+            if (!raw::read_dictionary(*build.previous.file, default_compression_level, *dictionary))
+            {
+                // The previous build fell back to plain compression; keep it consistent with the reused entries
+                LOG_INFO("Previous output has no dictionary, compressing without it");
+                return;
+            }
+            build.dictionary = dictionary;
+            return;
+        }
+        if (train_dictionary(entries, build.options, *dictionary)) build.dictionary = dictionary;
+    }
+
+    bool spill_payload(raw::PayloadBuilder &payload, const acul::string &path)
+    {
+        if (payload.spill_to(path)) return true;
+        LOG_ERROR("Failed to create spill file: %s", path.c_str());
+        return false;
+    }
+
+    acul::shared_ptr<umbf::RawBlock> release_payload(raw::PayloadBuilder &payload)
+    {
+        auto block = payload.release_block();
+        if (!block) LOG_ERROR("Failed to write the spilled payload");
+        return block;
+    }
+
+    bool convert_raw_directory(const acul::string &input, const acul::string &output, RawBuild &build,
+                               umbf::File &file)
+    {
+        const RawOptions &options = build.options;
         acul::vector<acul::string> files;
         auto lr = acul::fs::list_files(input, files, true);
         if (!lr.success())
@@ -174,59 +567,227 @@ namespace
 
         const acul::path base_path(input);
         const acul::string base_str = base_path.str();
-        auto library = acul::make_shared<umbf::Library>();
-        library->file_tree.name = ".";
-        library->file_tree.is_folder = true;
-
-        acul::vector<char> payload;
+        acul::vector<RawEntry> entries;
+        entries.reserve(files.size());
+        u64 total_size = 0;
         for (const auto &entry : files)
         {
             if (entry.size() <= base_str.size()) continue;
             size_t relative_offset = base_str.size();
             if (entry[relative_offset] == '/' || entry[relative_offset] == '\\') ++relative_offset;
-            const acul::path relative_path(entry.substr(relative_offset));
-            if (!build_raw_library_node(library->file_tree, relative_path, entry, mapped, compressed, &payload))
-                return false;
+            RawEntry raw_entry{entry, entry.substr(relative_offset), {}, {}};
+            raw_entry.key = library_key(acul::path(raw_entry.relative));
+            if (io::stat_file(entry, raw_entry.info)) total_size += raw_entry.info.size;
+            entries.push_back(std::move(raw_entry));
         }
 
-        const u8 flags = mapped ? static_cast<u8>(compressed ? UMBF_COMPRESSION_MAPPED_BIT : 0)
-                                : static_cast<u8>(compressed ? UMBF_COMPRESSION_PAYLOAD_BIT : 0);
-        create_file_structure(file, umbf::sign_block::format::library, flags);
+        auto library = acul::make_shared<umbf::Library>();
+        library->file_tree.name = ".";
+        library->file_tree.is_folder = true;
+
+        build.manifest.settings = raw_settings(options);
+        if (!options.incremental.empty())
+            build.incremental = load_previous_library(options.incremental, options, build.previous);
+        if (options.dictionary) prepare_dictionary(entries, build);
+
+        // Reading and compression run on the worker pool; the tree and the payload are assembled here in sorted
+        // order, so the output does not depend on the number of jobs.
+        // Entries appended as is (stored, or solid before the blocks are compressed) fill at most the sum of the
+        // source sizes, so that much is reserved and the payload is built in place. Compressed entries usually take
+        // a fraction of it; the payload grows as they arrive instead of reserving the whole tree up front.
+        if (options.spill)
+        {
+            if (!spill_payload(build.payload, output + ".payload.tmp")) return false;
+            if (options.solid_size > 0 && !spill_payload(build.solid, output + ".solid.tmp")) return false;
+        }
+        else if (options.mapped && (!options.compressed || options.solid_size > 0)) build.payload.reserve(total_size);
+        io::Prefetcher prefetcher(entries.size(), options.io_depth, [&](size_t i) -> const char * {
+            const RawEntry &entry = entries[i];
+            if (build.incremental && is_unmodified(entry, build.previous.find(entry.key))) return nullptr;
+            return entry.source.c_str();
+        });
+        const bool ok = run_ordered<PreparedEntry>(
+            entries.size(), options.jobs,
+            [&](size_t i) {
+                prefetcher.advance(i);
+                PreparedEntry entry;
+                entry.ok = prepare_raw_entry(entries[i], build, entry);
+                return entry;
+            },
+            [&](size_t i, PreparedEntry &entry) {
+                return entry.ok && build_raw_library_node(library->file_tree, entries[i], entry, build);
+            });
+        if (!ok) return false;
+        if (build.dedup.duplicates() > 0)
+            LOG_INFO("Deduplicated %zu entries, saved %" PRIu64 " bytes", build.dedup.duplicates(),
+                     build.dedup.saved_bytes());
+        if (build.incremental) LOG_INFO("Reused %zu of %zu entries", build.reused, entries.size());
+
+        const u8 flags = options.mapped ? static_cast<u8>(options.compressed ? UMBF_COMPRESSION_MAPPED_BIT : 0)
+                                        : static_cast<u8>(options.compressed ? UMBF_COMPRESSION_PAYLOAD_BIT : 0);
+        create_file_structure(file, library_type(build), flags);
         file.blocks.push_back(library);
+        acul::vector<acul::shared_ptr<umbf::RawBlock>> aux;
 
-        if (mapped)
+        if (options.mapped && options.solid_size > 0)
         {
-            auto raw = acul::make_shared<umbf::RawBlock>();
-            raw->data_size = payload.size();
-            raw->data = acul::alloc_n<char>(payload.size());
-            memcpy(raw->data, payload.data(), payload.size());
-            file.blocks.push_back(raw);
+            // Entries were appended uncompressed; the stream is cut in blocks that are compressed as units
+            auto stream = release_payload(build.payload);
+            if (!stream) return false;
+            raw::ChunkTable blocks;
+            if (!compress_chunks(stream->data, stream->data_size, options.solid_size, options.jobs, blocks,
+                                 build.solid))
+                return false;
+            LOG_INFO("Compressed %zu solid blocks: %" PRIu64 " -> %" PRIu64 " bytes", blocks.count(),
+                     blocks.raw_size, build.solid.size());
+            auto payload = release_payload(build.solid);
+            if (!payload) return false;
+            file.blocks.push_back(payload);
+            aux.push_back(raw::write_chunk_table(blocks));
         }
+        else if (options.mapped)
+        {
+            auto payload = release_payload(build.payload);
+            if (!payload) return false;
+            file.blocks.push_back(payload);
+        }
+        if (build.dictionary) aux.push_back(raw::write_dictionary(*build.dictionary));
+        if (options.mapped && options.compressed && options.adaptive)
+            aux.push_back(raw::make_aux_block(raw::aux_tag::entry_flags, {}));
+        if (!options.incremental.empty()) aux.push_back(raw::write_manifest(build.manifest));
+        raw::append_aux_blocks(file.blocks, aux);
+        return true;
+    }
+
+    // The payload of a single raw file is compressed when the file is saved. Adaptive mode compresses it up front
+    // once to measure the real ratio, so the output is never larger than the stored file.
+    bool worth_compressing_file(const io::MappedFile &source, const RawOptions &options)
+    {
+        const char *data = source.data();
+        const size_t size = source.size();
+        if (!raw::worth_compressing(data, size, options.min_ratio, default_compression_level)) return false;
+        acul::vector<char> compressed;
+        if (!acul::fs::compress(data, size, compressed, default_compression_level).success()) return false;
+        const f32 ratio = size > 0 ? static_cast<f32>(compressed.size()) / static_cast<f32>(size) : 1.0f;
+        return ratio <= options.min_ratio && compressed.size() < size;
+    }
+
+    // The data block is flagged with the mapped bit instead of the payload one, so the file itself is stored as is
+    // and readers go through the chunk table. Stock readers would take the chunk stream for the data, hence the
+    // extended type.
+    bool convert_raw_chunked(const acul::string &input, const io::MappedFile &source, const RawOptions &options,
+                             umbf::File &file)
+    {
+        raw::ChunkTable table;
+        raw::PayloadBuilder payload;
+        if (!compress_chunks(source.data(), source.size(), options.chunk_size, options.jobs, table, payload))
+        {
+            LOG_ERROR("Failed to compress raw file: %s", input.c_str());
+            return false;
+        }
+        create_file_structure(file, raw::extended_type(umbf::sign_block::format::raw), UMBF_COMPRESSION_MAPPED_BIT);
+        file.blocks.push_back(payload.release_block());
+        raw::append_aux_blocks(file.blocks, {raw::write_chunk_table(table)});
         return true;
     }
 } // namespace
 
-bool convert_raw(const acul::string &input, bool compressed, bool recursive, bool mapped, umbf::File &file)
+u32 convert_raw(const acul::string &input, const acul::string &output, const RawOptions &options)
 {
+    // Declared ahead of the build state: spilled payloads and borrowed sources are detached from their blocks when
+    // the build is destroyed, so the file has to be saved before that and outlive it
+    umbf::File file;
+    raw::BorrowedBlocks borrowed;
     if (acul::fs::is_directory(input.c_str()))
     {
-        if (!recursive)
+        if (options.chunk_size > 0)
+        {
+            LOG_ERROR("--chunk-size is supported only for single file raw conversion");
+            return 0;
+        }
+        if (!options.recursive)
         {
             LOG_ERROR("Directory input for raw conversion requires -R");
-            return false;
+            return 0;
         }
-        return convert_raw_directory(input, compressed, mapped, file);
+        if (options.solid_size > 0)
+        {
+            if (!options.mapped || !options.compressed)
+            {
+                LOG_ERROR("--solid requires --mapped and --compressed");
+                return 0;
+            }
+            if (options.adaptive || options.dictionary || !options.incremental.empty())
+            {
+                LOG_ERROR("--solid cannot be combined with --adaptive, --dictionary or --incremental");
+                return 0;
+            }
+        }
+        if (options.dictionary)
+        {
+            if (!options.mapped || !options.compressed)
+            {
+                LOG_ERROR("--dictionary requires --mapped and --compressed");
+                return 0;
+            }
+            if (!raw::Dictionary::supported())
+            {
+                LOG_ERROR("--dictionary is not available: built without zstd dictionary support");
+                return 0;
+            }
+        }
+        if (options.spill && !options.mapped)
+        {
+            LOG_ERROR("--spill requires --mapped");
+            return 0;
+        }
+        RawBuild build(options);
+        if (!convert_raw_directory(input, output, build, file)) return 0;
+        return file.save(output) ? file.checksum : 0;
     }
 
-    if (mapped)
+    if (options.mapped)
     {
         LOG_ERROR("--mapped is supported only for recursive raw directory conversion");
-        return false;
+        return 0;
+    }
+
+    if (!options.incremental.empty())
+    {
+        LOG_ERROR("--incremental is supported only for recursive raw directory conversion");
+        return 0;
+    }
+
+    if (options.dictionary || options.solid_size > 0 || options.spill)
+    {
+        LOG_ERROR("--dictionary, --solid and --spill are supported only for mapped raw libraries");
+        return 0;
     }
 
-    create_file_structure(file, umbf::sign_block::format::raw,
-                          compressed ? UMBF_COMPRESSION_PAYLOAD_BIT : 0);
-    return convert_raw_file(input, file);
+    if (options.chunk_size > 0 && !options.compressed)
+    {
+        LOG_ERROR("--chunk-size requires --compressed");
+        return 0;
+    }
+
+    io::MappedFile source;
+    if (!open_raw_file(input, source)) return 0;
+    bool compressed = options.compressed;
+    if (compressed && options.adaptive && !worth_compressing_file(source, options))
+    {
+        LOG_INFO("Input does not compress well, storing it uncompressed");
+        compressed = false;
+    }
+    if (compressed && options.chunk_size > 0)
+    {
+        if (!convert_raw_chunked(input, source, options, file)) return 0;
+    }
+    else
+    {
+        create_file_structure(file, umbf::sign_block::format::raw, compressed ? UMBF_COMPRESSION_PAYLOAD_BIT : 0);
+        file.blocks.push_back(borrowed.borrow(std::move(source)));
+    }
+    return file.save(output) ? file.checksum : 0;
 }
 
 bool convert_image(const acul::string &input, bool compressed, umbf::File &file)
@@ -250,21 +811,114 @@ bool convert_image(const acul::string &input, bool compressed, umbf::File &file)
     return ret;
 }
 
-acul::shared_ptr<umbf::Image2D> model_to_image(const models::IPath &model)
+// State shared by the steps of a JSON conversion
+struct ConvertContext
 {
-    auto importer = aecl::image::get_importer_by_path(model.path());
-    acul::vector<umbf::Image2D> images;
-    acul::shared_ptr<umbf::Image2D> dst_image;
-    if (importer)
-    {
-        if (importer->load(model.path(), images)) dst_image = acul::make_shared<umbf::Image2D>(images.front());
-        else LOG_ERROR("AECL error: %s", importer->error().c_str());
-        acul::release(importer);
-    }
-    return dst_image;
+    const JsonOptions &options;
+    pixels::ImageCache images; // Sources decoded so far, shared by every asset of the run
+    raw::BorrowedBlocks raw_sources; // Raw library entries point at their mapped sources until the save
+};
+
+// Sources are decoded and converted on the worker pool but collected in their original order, so pack_data
+// and the packing result do not depend on the number of jobs
+bool decode_atlas_sources(ConvertContext &ctx, const acul::vector<acul::shared_ptr<models::IPath>> &images,
+                          const umbf::Image2D &image_block, acul::vector<amal::irect> &pack_data,
+                          acul::vector<acul::shared_ptr<umbf::Image2D>> &sprites)
+{
+    return run_ordered<acul::shared_ptr<umbf::Image2D>>(
+        images.size(), ctx.options.jobs,
+        [&](size_t i) { return ctx.images.load(images[i]->path(), image_block.format, image_block.channels.size()); },
+        [&](size_t i, acul::shared_ptr<umbf::Image2D> &image) {
+            if (!image)
+            {
+                LOG_ERROR("Failed to create image: %s", images[i]->path().c_str());
+                return false;
+            }
+            pack_data.push_back({{-1, -1}, {static_cast<i32>(image->width), static_cast<i32>(image->height)}});
+            sprites.push_back(std::move(image));
+            return true;
+        });
+}
+
+// First pass of a streamed atlas: sprite sizes from the image headers. Formats the prober does not know are
+// decoded and dropped right away.
+bool probe_atlas_sources(ConvertContext &ctx, const acul::vector<acul::shared_ptr<models::IPath>> &images,
+                         acul::vector<amal::irect> &pack_data)
+{
+    return run_ordered<amal::ivec2>(
+        images.size(), ctx.options.jobs,
+        [&](size_t i) {
+            u32 width = 0, height = 0;
+            if (pixels::probe_size(images[i]->path(), width, height))
+                return amal::ivec2{static_cast<i32>(width), static_cast<i32>(height)};
+            auto image = pixels::decode_image(images[i]->path());
+            if (!image) return amal::ivec2{0, 0};
+            acul::release(image->pixels);
+            return amal::ivec2{static_cast<i32>(image->width), static_cast<i32>(image->height)};
+        },
+        [&](size_t i, amal::ivec2 &size) {
+            if (size.x <= 0 || size.y <= 0)
+            {
+                LOG_ERROR("Failed to create image: %s", images[i]->path().c_str());
+                return false;
+            }
+            pack_data.push_back({{-1, -1}, size});
+            return true;
+        });
+}
+
+// Second pass of a streamed atlas: sources are decoded and converted on the workers and blitted in pack_data
+// order as they complete, then freed. Only the atlas and the window of sources in flight are held in memory, and
+// the sources bypass the image cache.
+struct AtlasPageBlocks
+{
+    acul::shared_ptr<umbf::Image2D> image;
+    acul::shared_ptr<umbf::Atlas> atlas;
+};
+
+bool blit_atlas_sources(ConvertContext &ctx, const acul::vector<acul::shared_ptr<models::IPath>> &images,
+                        const acul::vector<AtlasPageBlocks> &pages, const acul::vector<u32> &page_of)
+{
+    for (const auto &page : pages) pixels::allocate_atlas(*page.image);
+    const umbf::Image2D &image_block = *pages.front().image;
+    return run_ordered<acul::shared_ptr<umbf::Image2D>>(
+        images.size(), ctx.options.jobs,
+        [&](size_t i) {
+            const auto &path = images[i]->path();
+            auto image = pixels::decode_image(path);
+            if (!image || (image->channels.size() == image_block.channels.size() &&
+                           !(image->format != image_block.format)))
+                return image;
+            auto converted = pixels::convert_image(*image, path, image_block.format, image_block.channels.size());
+            acul::release(image->pixels);
+            return converted;
+        },
+        [&](size_t i, acul::shared_ptr<umbf::Image2D> &image) {
+            if (!image)
+            {
+                LOG_ERROR("Failed to create image: %s", images[i]->path().c_str());
+                return false;
+            }
+            const auto &page = pages[page_of[i]];
+            const auto &rect = page.atlas->pack_data[i];
+            if (pixels::is_rotated(rect, *image))
+            {
+                auto rotated = pixels::rotate_sprite(*image);
+                acul::release(image->pixels);
+                image = std::move(rotated);
+            }
+            const bool matches = static_cast<i32>(image->width) == rect.size.x &&
+                                 static_cast<i32>(image->height) == rect.size.y;
+            if (matches) pixels::blit_sprite(*page.image, *page.atlas, rect, *image);
+            else
+                LOG_ERROR("Image size differs from its header: %s (%ux%u)", images[i]->path().c_str(), image->width,
+                          image->height);
+            acul::release(image->pixels);
+            return matches;
+        });
 }
 
-bool convert_atlas(const models::Atlas &atlas, bool compressed, umbf::File &file)
+bool convert_atlas(ConvertContext &ctx, const models::Atlas &atlas, bool compressed, umbf::File &file)
 {
     create_file_structure(file, umbf::sign_block::format::image, compressed);
     auto image_block = acul::make_shared<umbf::Image2D>();
@@ -276,57 +930,153 @@ bool convert_atlas(const models::Atlas &atlas, bool compressed, umbf::File &file
     atlas_block->padding = 1;
     acul::vector<acul::shared_ptr<umbf::Image2D>> atlas_dst_images;
     atlas_dst_images.reserve(atlas.images().size());
-    for (const auto &image : atlas.images())
+    atlas_block->pack_data.reserve(atlas.images().size());
+    const auto &images = atlas.images();
+    const bool sized = ctx.options.stream_atlas
+                           ? probe_atlas_sources(ctx, images, atlas_block->pack_data)
+                           : decode_atlas_sources(ctx, images, *image_block, atlas_block->pack_data, atlas_dst_images);
+    if (!sized) return false;
+
+    // Trimmed sprites are packed at the size of their opaque part, and aliases of an earlier sprite are not
+    // packed at all but share its rect
+    pixels::SpriteTable sprite_table;
+    acul::vector<acul::shared_ptr<umbf::Image2D>> trimmed;
+    if (ctx.options.trim_sprites)
+    {
+        trimmed = pixels::trim_sprites(atlas_dst_images, sprite_table, ctx.options.jobs);
+        for (size_t i = 0; i < atlas_dst_images.size(); ++i)
+            atlas_block->pack_data[i].size = {static_cast<i32>(atlas_dst_images[i]->width),
+                                              static_cast<i32>(atlas_dst_images[i]->height)};
+    }
+    else if (ctx.options.pack_rotate)
     {
-        auto pImage = model_to_image(*image);
-        if (!pImage)
+        // Untrimmed sprites cover their whole source, the table only records which of them are rotated
+        sprite_table.sprites.resize(images.size());
+        for (size_t i = 0; i < images.size(); ++i)
         {
-            LOG_ERROR("Failed to create image: %s", image->path().c_str());
-            return false;
+            auto &sprite = sprite_table.sprites[i];
+            sprite.source_width = static_cast<u32>(atlas_block->pack_data[i].size.x);
+            sprite.source_height = static_cast<u32>(atlas_block->pack_data[i].size.y);
+            sprite.alias = static_cast<u32>(i);
         }
-        if (pImage->channels.size() != image_block->channels.size() || pImage->format != image_block->format)
+    }
+    auto is_alias = [&](size_t i) { return ctx.options.trim_sprites && sprite_table.sprites[i].alias != i; };
+    acul::vector<size_t> packed;
+    acul::vector<amal::irect> pack_input;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        if (is_alias(i)) continue;
+        packed.push_back(i);
+        pack_input.push_back(atlas_block->pack_data[i]);
+    }
+
+    const auto modes = pixels::atlas_pack_modes(ctx.options.pack_all, ctx.options.pack_rotate);
+    acul::vector<pixels::AtlasPage> pages;
+    if (ctx.options.max_page_size == 0)
+    {
+        pixels::AtlasPage page;
+        page.layout = pixels::find_best_atlas_layout(pack_input, atlas_block->padding, ctx.options.jobs, modes);
+        page.indices.resize(pack_input.size());
+        for (size_t i = 0; i < pack_input.size(); ++i) page.indices[i] = i;
+        pages.push_back(std::move(page));
+    }
+    else if (!pixels::pack_atlas_pages(pack_input, atlas_block->padding,
+                                       static_cast<i32>(ctx.options.max_page_size), ctx.options.jobs, modes, pages))
+    {
+        for (const auto &sprite : trimmed) acul::release(sprite->pixels);
+        return false;
+    }
+
+    // Every page is an Image2D/Atlas block pair whose pack_data lists all sprites in input order. Sprites placed on
+    // other pages keep their size at position (-1, -1), and the page table block records where each one went.
+    const acul::vector<amal::irect> unplaced = atlas_block->pack_data;
+    acul::vector<AtlasPageBlocks> page_blocks;
+    acul::vector<u32> page_of(images.size(), 0);
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        AtlasPageBlocks blocks;
+        blocks.image = p == 0 ? image_block : acul::make_shared<umbf::Image2D>(*image_block);
+        blocks.image->width = pages[p].layout.size.x;
+        blocks.image->height = pages[p].layout.size.y;
+        blocks.atlas = p == 0 ? atlas_block : acul::make_shared<umbf::Atlas>();
+        blocks.atlas->padding = atlas_block->padding;
+        blocks.atlas->pack_data = unplaced;
+        for (size_t j = 0; j < pages[p].indices.size(); ++j)
         {
-            LOG_INFO("Converting image to the atlas format: %s", image->path().c_str());
-            void *converted = umbf::utils::convert_image(*pImage, image_block->format, image_block->channels.size());
-            pImage->pixels = converted;
-            pImage->format = image_block->format;
+            const size_t index = packed[pages[p].indices[j]];
+            page_of[index] = static_cast<u32>(p);
+            blocks.atlas->pack_data[index] = pages[p].layout.rects[j];
+            if (ctx.options.pack_rotate && pages[p].layout.rects[j].size.x != unplaced[index].size.x)
+                sprite_table.sprites[index].flags |= pixels::sprite_rotated;
         }
-        atlas_dst_images.push_back(pImage);
-        atlas_block->pack_data.push_back(
-            {{-1, -1}, {static_cast<i32>(pImage->width), static_cast<i32>(pImage->height)}});
+        page_blocks.push_back(std::move(blocks));
+    }
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        if (!is_alias(i)) continue;
+        const u32 alias = sprite_table.sprites[i].alias;
+        page_of[i] = page_of[alias];
+        page_blocks[page_of[i]].atlas->pack_data[i] = page_blocks[page_of[i]].atlas->pack_data[alias];
+        sprite_table.sprites[i].flags = sprite_table.sprites[alias].flags;
+        atlas_dst_images[i] = nullptr; // Blitted with the sprite it aliases
     }
 
-    const amal::ivec2 atlas_size = find_min_square_atlas_size(atlas_block->pack_data, atlas_block->padding);
-    image_block->width = atlas_size.x;
-    image_block->height = atlas_size.y;
-
-    if (!umbf::utils::pack_max_rects(atlas_size, 0,
-                                     atlas_block->pack_data, umbf::utils::MaxRectsHeuristic::best_short_side_fit,
-                                     umbf::utils::MaxRectsTransformBits::none, atlas_block->padding)
-             .packed)
+    if (!ctx.options.stream_atlas)
     {
-        LOG_ERROR("Failed to pack atlas");
+        // Cached sources are shared, rotated sprites get their own copies
+        acul::vector<acul::shared_ptr<umbf::Image2D>> rotated;
+        for (size_t i = 0; i < atlas_dst_images.size(); ++i)
+        {
+            if (!atlas_dst_images[i]) continue;
+            if (!pixels::is_rotated(page_blocks[page_of[i]].atlas->pack_data[i], *atlas_dst_images[i])) continue;
+            atlas_dst_images[i] = pixels::rotate_sprite(*atlas_dst_images[i]);
+            rotated.push_back(atlas_dst_images[i]);
+        }
+        for (const auto &page : page_blocks)
+            pixels::fill_atlas(*page.image, *page.atlas, atlas_dst_images, ctx.options.jobs);
+        for (const auto &sprite : rotated) acul::release(sprite->pixels);
+        for (const auto &sprite : trimmed) acul::release(sprite->pixels);
+    }
+    else if (!blit_atlas_sources(ctx, images, page_blocks, page_of))
+    {
+        for (const auto &page : page_blocks) acul::release(page.image->pixels);
         return false;
     }
-    umbf::fill_atlas_pixels(image_block, atlas_block, atlas_dst_images);
 
-    file.blocks.push_back(image_block);
-    file.blocks.push_back(atlas_block);
+    for (const auto &page : page_blocks)
+    {
+        file.blocks.push_back(page.image);
+        file.blocks.push_back(page.atlas);
+    }
+    acul::vector<acul::shared_ptr<umbf::RawBlock>> aux;
+    if (page_blocks.size() > 1)
+    {
+        pixels::AtlasPageTable table;
+        table.pages = static_cast<u32>(page_blocks.size());
+        table.page_of = std::move(page_of);
+        aux.push_back(pixels::write_page_table(table));
+    }
+    if (!sprite_table.sprites.empty()) aux.push_back(pixels::write_sprite_table(sprite_table));
+    raw::append_aux_blocks(file.blocks, aux);
 
     return true;
 }
 
-bool convert_image(const models::Image &image, bool compressed, umbf::File &file)
+bool convert_image(ConvertContext &ctx, const models::Image &image, bool compressed, umbf::File &file)
 {
     if (image.signature() == umbf::sign_block::image)
     {
         auto serializer = acul::static_pointer_cast<models::IPath>(image.serializer());
-        return convert_image(serializer->path(), compressed, file);
+        auto decoded = ctx.images.load(serializer->path());
+        if (!decoded) return false;
+        create_file_structure(file, umbf::sign_block::format::image, compressed);
+        file.blocks.push_back(acul::make_shared<umbf::Image2D>(*decoded));
+        return true;
     }
     else if (image.signature() == umbf::sign_block::image_atlas)
     {
         auto serializer = acul::static_pointer_cast<models::Atlas>(image.serializer());
-        return convert_atlas(*serializer, compressed, file);
+        return convert_atlas(ctx, *serializer, compressed, file);
     }
     LOG_ERROR("Unsupported image type: %x", image.signature());
     return false;
@@ -342,14 +1092,15 @@ void convert_target(const models::Target &target, bool compressed, umbf::File &f
     file.blocks.push_back(block);
 }
 
-bool convert_image(const acul::shared_ptr<models::UMBFRoot> &model, bool compressed, umbf::File &file)
+bool convert_image(ConvertContext &ctx, const acul::shared_ptr<models::UMBFRoot> &model, bool compressed,
+                   umbf::File &file)
 {
     switch (model->type_sign)
     {
         case umbf::sign_block::format::image:
         {
             auto image_model = acul::static_pointer_cast<models::Image>(model);
-            return convert_image(*image_model, compressed, file);
+            return convert_image(ctx, *image_model, compressed, file);
         }
         case umbf::sign_block::format::target:
         {
@@ -363,7 +1114,7 @@ bool convert_image(const acul::shared_ptr<models::UMBFRoot> &model, bool compres
     }
 }
 
-bool convert_material(const models::Material &material, bool compressed, umbf::File &file)
+bool convert_material(ConvertContext &ctx, const models::Material &material, bool compressed, umbf::File &file)
 {
     create_file_structure(file, umbf::sign_block::format::material, compressed);
     auto block = acul::make_shared<umbf::Material>();
@@ -371,7 +1122,7 @@ bool convert_material(const models::Material &material, bool compressed, umbf::F
     for (auto &texture : material.textures())
     {
         umbf::File texture_file;
-        if (convert_image(texture, compressed, texture_file)) block->textures.push_back(texture_file);
+        if (convert_image(ctx, texture, compressed, texture_file)) block->textures.push_back(texture_file);
         else return false;
     }
     file.blocks.push_back(block);
@@ -380,23 +1131,51 @@ bool convert_material(const models::Material &material, bool compressed, umbf::F
 
 acul::unique_ptr<aecl::scene::ILoader> import_mesh(const acul::string &input)
 {
+    // Nothing guarantees the aecl importers are reentrant, so only one file is parsed at a time
+    static std::mutex importer_lock;
     auto ext = acul::fs::get_extension(input);
     if (ext == ".obj")
     {
-        auto obj_loader = acul::make_unique<aecl::scene::obj::Importer>(input);
-        aecl::scene::obj::Importer importer(input);
-        if (!importer.load())
+        std::lock_guard<std::mutex> lock(importer_lock);
+        auto importer = acul::make_unique<aecl::scene::obj::Importer>(input);
+        if (!importer->load())
         {
-            LOG_ERROR("Failed to load obj: %s", importer.path().c_str());
+            LOG_ERROR("Failed to load obj: %s", importer->path().c_str());
             return nullptr;
         }
-        return std::move(obj_loader);
+        return std::move(importer);
     }
     LOG_ERROR("Unsupported mesh format: %s", ext.c_str());
     return nullptr;
 }
 
-u32 convert_scene(const acul::string &input, const acul::string &output, bool compressed)
+// Runs the requested stages on every mesh of the objects, `jobs` meshes at a time. Returns true if a mesh was
+// quantized, the file then has to be marked as extended (raw/format.hpp).
+bool process_meshes(acul::vector<umbf::Object> &objects, const MeshOptions &options, u32 jobs)
+{
+    if (options.optimize)
+    {
+        acul::vector<umbf::Mesh *> meshes;
+        for (auto &object : objects)
+            for (auto &block : object.meta)
+                if (block->signature() == umbf::sign_block::mesh)
+                    meshes.push_back(static_cast<umbf::Mesh *>(block.get()));
+        acul::vector<mesh::OptimizeStats> stats(meshes.size());
+        parallel_for(meshes.size(), jobs, [&](size_t i) { mesh::optimize(*meshes[i], stats[i]); });
+        mesh::OptimizeStats total;
+        for (const auto &mesh_stats : stats) total.add(mesh_stats);
+        LOG_INFO("Optimized %zu meshes: ACMR %.3f -> %.3f, %" PRIu64 " -> %" PRIu64 " bytes", meshes.size(),
+                 total.acmr_before(), total.acmr_after(), total.bytes_before, total.bytes_after);
+    }
+    // Quantized after optimizing, so welding still compares the full-precision vertices
+    if (!options.quantize) return false;
+    acul::vector<u8> quantized(objects.size(), 0);
+    parallel_for(objects.size(), jobs, [&](size_t i) { quantized[i] = mesh::quantize_object(objects[i]); });
+    return std::find(quantized.begin(), quantized.end(), 1) != quantized.end();
+}
+
+u32 convert_scene(const acul::string &input, const acul::string &output, bool compressed,
+                  const MeshOptions &meshes, u32 jobs)
 {
     auto importer = import_mesh(input);
     if (!importer) return 0;
@@ -406,6 +1185,7 @@ u32 convert_scene(const acul::string &input, const acul::string &output, bool co
 
     auto block = acul::make_shared<umbf::Scene>();
     block->objects = importer->objects();
+    if (process_meshes(block->objects, meshes, jobs)) file.header.type_sign = raw::extended_type(file.header.type_sign);
     block->materials.reserve(importer->materials().size());
     for (auto &material : importer->materials()) block->materials.push_back(*material);
     auto &textures = importer->textures();
@@ -419,27 +1199,36 @@ u32 convert_scene(const acul::string &input, const acul::string &output, bool co
     return file.save(output) ? file.checksum : 0;
 }
 
-bool convert_scene(models::Scene &scene, bool compressed, umbf::File &file)
+bool convert_scene(ConvertContext &ctx, models::Scene &scene, bool compressed, umbf::File &file)
 {
     create_file_structure(file, umbf::sign_block::format::scene, compressed);
     auto scene_block = acul::make_shared<umbf::Scene>();
     scene_block->objects.reserve(scene.meshes().size());
     acul::vector<acul::vector<u64>> materials_ids(scene.materials().size());
-    for (auto &mesh : scene.meshes())
+    // Meshes are parsed one at a time (see import_mesh) while the next files are read ahead, and each importer
+    // is released as soon as its objects are copied. The mesh stages run on the worker pool afterwards.
+    const auto &meshes = scene.meshes();
+    acul::vector<acul::string> paths(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) paths[i] = meshes[i]->path();
+    io::Prefetcher prefetcher(paths.size(), mesh_read_ahead, [&](size_t i) { return paths[i].c_str(); });
+    for (size_t i = 0; i < meshes.size(); ++i)
     {
-        auto importer = import_mesh(mesh->path());
+        prefetcher.advance(i);
+        auto importer = import_mesh(paths[i]);
         if (!importer) return false;
         for (auto &object : importer->objects())
         {
             scene_block->objects.push_back(object);
-            if (mesh->mat_id() != -1) materials_ids[mesh->mat_id()].push_back(object.id);
+            if (meshes[i]->mat_id() != -1) materials_ids[meshes[i]->mat_id()].push_back(object.id);
         }
     }
+    if (process_meshes(scene_block->objects, ctx.options.meshes, ctx.options.jobs))
+        file.header.type_sign = raw::extended_type(file.header.type_sign);
     file.blocks.push_back(scene_block);
     for (auto &texture : scene.textures())
     {
         umbf::File texture_file;
-        if (convert_image(texture, compressed, texture_file)) scene_block->textures.push_back(texture_file);
+        if (convert_image(ctx, texture, compressed, texture_file)) scene_block->textures.push_back(texture_file);
         else return false;
     }
 
@@ -450,7 +1239,7 @@ bool convert_scene(models::Scene &scene, bool compressed, umbf::File &file)
         if (material.asset->type_sign == umbf::sign_block::format::material)
         {
             auto material_model = acul::static_pointer_cast<models::Material>(material.asset);
-            if (!convert_material(*material_model, compressed, material_file)) return false;
+            if (!convert_material(ctx, *material_model, compressed, material_file)) return false;
         }
         else if (material.asset->type_sign == umbf::sign_block::format::target)
         {
@@ -473,7 +1262,7 @@ bool convert_scene(models::Scene &scene, bool compressed, umbf::File &file)
     return true;
 }
 
-void prepare_library_node(const models::FileNode &src, umbf::Library::Node &dst)
+void prepare_library_node(ConvertContext &ctx, const models::FileNode &src, umbf::Library::Node &dst)
 {
     if (src.children.empty())
     {
@@ -487,15 +1276,16 @@ void prepare_library_node(const models::FileNode &src, umbf::Library::Node &dst)
             switch (src.asset->type_sign)
             {
                 case umbf::sign_block::format::image:
-                    if (!convert_image(src.asset, false, dst.asset))
+                    if (!convert_image(ctx, src.asset, false, dst.asset))
                         throw acul::runtime_error("Failed to create asset file");
                     break;
                 case umbf::sign_block::format::material:
-                    if (!convert_material(*acul::static_pointer_cast<models::Material>(src.asset), false, dst.asset))
+                    if (!convert_material(ctx, *acul::static_pointer_cast<models::Material>(src.asset), false,
+                                          dst.asset))
                         throw acul::runtime_error("Failed to create asset file");
                     break;
                 case umbf::sign_block::format::scene:
-                    if (!convert_scene(*acul::static_pointer_cast<models::Scene>(src.asset), false, dst.asset))
+                    if (!convert_scene(ctx, *acul::static_pointer_cast<models::Scene>(src.asset), false, dst.asset))
                         throw acul::runtime_error("Failed to create asset file");
                     break;
                 case umbf::sign_block::format::target:
@@ -503,7 +1293,8 @@ void prepare_library_node(const models::FileNode &src, umbf::Library::Node &dst)
                     break;
                 case umbf::sign_block::format::raw:
                     create_file_structure(dst.asset, umbf::sign_block::format::raw);
-                    if (!convert_raw_file(acul::static_pointer_cast<models::IPath>(src.asset)->path(), dst.asset))
+                    if (!convert_raw_file(acul::static_pointer_cast<models::IPath>(src.asset)->path(), ctx.raw_sources,
+                                          dst.asset))
                         throw acul::runtime_error("Failed to create asset file");
                     break;
                 default:
@@ -520,24 +1311,27 @@ void prepare_library_node(const models::FileNode &src, umbf::Library::Node &dst)
         for (const auto &child : src.children)
         {
             umbf::Library::Node node;
-            prepare_library_node(child, node);
+            prepare_library_node(ctx, child, node);
             dst.children.push_back(node);
         }
     }
 }
 
-u32 convert_library(const models::Library &library, const acul::string &output, bool compressed)
+u32 convert_library(ConvertContext &ctx, const models::Library &library, const acul::string &output,
+                    bool compressed)
 {
     umbf::File file;
     create_file_structure(file, umbf::sign_block::format::library, compressed);
     auto block = acul::make_shared<umbf::Library>();
-    prepare_library_node(library.file_tree(), block->file_tree);
+    prepare_library_node(ctx, library.file_tree(), block->file_tree);
     file.blocks.push_back(block);
     return file.save(output) ? file.checksum : 0;
 }
 
-u32 convert_json(const acul::string &input, const acul::string &output, bool compressed)
+u32 convert_json(const acul::string &input, const acul::string &output, const JsonOptions &options)
 {
+    ConvertContext ctx{options};
+    const bool compressed = options.compressed;
     rapidjson::Document json;
     models::UMBFRoot root;
     if (!root.deserialize_from_file(input, json))
@@ -556,7 +1350,7 @@ u32 convert_json(const acul::string &input, const acul::string &output, bool com
                 return 0;
             }
             umbf::File file;
-            if (!convert_image(image, compressed, file)) return 0;
+            if (!convert_image(ctx, image, compressed, file)) return 0;
             return file.save(output) ? file.checksum : 0;
         }
         case umbf::sign_block::format::material:
@@ -568,7 +1362,7 @@ u32 convert_json(const acul::string &input, const acul::string &output, bool com
                 return 0;
             }
             umbf::File file;
-            if (!convert_material(material, compressed, file)) return 0;
+            if (!convert_material(ctx, material, compressed, file)) return 0;
             return file.save(output) ? file.checksum : 0;
         }
         case umbf::sign_block::format::scene:
@@ -580,7 +1374,7 @@ u32 convert_json(const acul::string &input, const acul::string &output, bool com
                 return 0;
             }
             umbf::File file;
-            if (!convert_scene(scene, compressed, file)) return 0;
+            if (!convert_scene(ctx, scene, compressed, file)) return 0;
             return file.save(output) ? file.checksum : 0;
         }
         case umbf::sign_block::format::target:
@@ -603,7 +1397,7 @@ u32 convert_json(const acul::string &input, const acul::string &output, bool com
                 LOG_ERROR("Failed to deserialize library: %s", input.c_str());
                 return 0;
             }
-            return convert_library(library, output, compressed);
+            return convert_library(ctx, library, output, compressed);
         }
         default:
             LOG_ERROR("Unsupported type: %x", root.type_sign);
@@ -1,11 +1,54 @@
 #pragma once
 #include <acul/string/string.hpp>
+#include <aecl/scene/obj/import.hpp>
 #include <umbf/umbf.hpp>
 
-bool convert_raw(const acul::string &input, bool compressed, bool recursive, bool mapped, umbf::File &file);
+struct RawOptions
+{
+    bool compressed = false;
+    bool recursive = false;
+    bool mapped = false;
+    bool adaptive = false;    // Store entries that do not compress well uncompressed
+    f32 min_ratio = 0.95f;    // Compressed/original size an entry must reach to be stored compressed
+    bool dictionary = false;  // Compress mapped entries against a dictionary trained on the input
+    u32 dict_size = 112640;   // Maximal size of the trained dictionary in bytes
+    u64 solid_size = 0;       // Compress mapped entries together in blocks of this size (0 - each entry alone)
+    bool spill = false;       // Stream the mapped payload to a temporary file next to the output instead of memory
+    u64 chunk_size = 0;       // Compress a single raw file in independent chunks of this size (0 - one stream)
+    u32 jobs = 1;             // Worker threads used to read and compress entries or chunks
+    u32 io_depth = 64;        // Files of a recursive import read ahead of the workers (0 - no read-ahead)
+    acul::string incremental; // Previous output to take unchanged entries from
+};
 
-u32 convert_image(const acul::string &input, bool compressed, umbf::File &file);
+// Builds and saves the raw asset or library, returns the checksum of the saved file or 0 on failure
+u32 convert_raw(const acul::string &input, const acul::string &output, const RawOptions &options);
 
-u32 convert_scene(const acul::string &input, const acul::string &output, bool compressed);
+bool convert_image(const acul::string &input, bool compressed, umbf::File &file);
 
-u32 convert_json(const acul::string &input, const acul::string &output, bool compressed);
+// Loads a mesh file with the aecl importer of its extension, returns nullptr on failure. The file is parsed once,
+// by the importer itself.
+acul::unique_ptr<aecl::scene::ILoader> import_mesh(const acul::string &input);
+
+struct MeshOptions
+{
+    bool optimize = false; // Weld vertices, then reorder triangles and vertices for the GPU caches
+    bool quantize = false; // Store vertices as 16-bit positions, octahedral normals and 16-bit UVs
+};
+
+// `jobs` meshes are processed at a time
+u32 convert_scene(const acul::string &input, const acul::string &output, bool compressed,
+                  const MeshOptions &meshes = {}, u32 jobs = 1);
+
+struct JsonOptions
+{
+    bool compressed = false;
+    u32 jobs = 1;              // Worker threads decoding image sources, e.g. the sprites of an atlas
+    bool stream_atlas = false; // Pack atlases from image headers and blit the sources one at a time
+    u32 max_page_size = 0;     // Side limit of an atlas page, overflow goes to more pages (0 - one unbounded page)
+    bool pack_all = false;     // Pack atlases with every heuristic and keep the smallest result
+    bool pack_rotate = false;  // Allow sprites to be rotated by 90 degrees when packing atlases
+    bool trim_sprites = false; // Pack the opaque part of atlas sprites only and share rects between duplicates
+    MeshOptions meshes;        // Processing of the meshes of scenes
+};
+
+u32 convert_json(const acul::string &input, const acul::string &output, const JsonOptions &options);
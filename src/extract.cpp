@@ -6,9 +6,14 @@
 #include <aecl/scene/obj/export.hpp>
 #include <inttypes.h>
 #include <umbf/umbf.hpp>
+#include "extract.hpp"
+#include "mesh/quantize.hpp"
+#include "raw/chunked.hpp"
+#include "raw/format.hpp"
+#include "raw/layout.hpp"
 
 
-bool extract_raw(const umbf::File *file, const acul::string &output)
+bool extract_raw(const umbf::File *file, const acul::string &output, const ExtractOptions &options = {})
 {
     if (file->blocks.empty())
     {
@@ -27,7 +32,24 @@ bool extract_raw(const umbf::File *file, const acul::string &output)
         LOG_ERROR("Failed to cast block to RawBlock");
         return false;
     }
-    return acul::fs::write_binary(output, raw_block->data, raw_block->data_size);
+
+    const u64 length = options.length > 0 ? options.length : UINT64_MAX;
+    raw::ChunkTable table;
+    if (raw::read_chunk_table(*file, table))
+    {
+        // Only the chunks covering the requested range are decompressed
+        acul::vector<char> data;
+        if (!raw::read_chunked_range(*raw_block, table, options.offset, length, options.jobs, data))
+        {
+            LOG_ERROR("Failed to decompress chunked payload");
+            return false;
+        }
+        return acul::fs::write_binary(output, data.data(), data.size());
+    }
+
+    const u64 offset = std::min<u64>(options.offset, raw_block->data_size);
+    const u64 size = std::min<u64>(length, raw_block->data_size - offset);
+    return acul::fs::write_binary(output, raw_block->data + offset, size);
 }
 
 bool save_image(const acul::string &output, const umbf::Image2D &image)
@@ -164,6 +186,13 @@ bool extract_scene(umbf::File *file, const acul::string &output)
     exporter->mesh_flags = aecl::scene::MeshExportFlagBits::export_normals | aecl::scene::MeshExportFlagBits::export_uv;
     exporter->material_flags = aecl::scene::MaterialExportFlags::texture_origin;
     exporter->objects = scene->objects;
+    for (auto &object : exporter->objects)
+        if (!mesh::dequantize_object(object))
+        {
+            LOG_ERROR("Failed to read quantized mesh: %s", object.name.c_str());
+            acul::release(exporter);
+            return false;
+        }
     exporter->materials = scene->materials;
     exporter->textures.resize(scene->textures.size());
     auto &textures = exporter->textures;
@@ -175,7 +204,18 @@ bool extract_scene(umbf::File *file, const acul::string &output)
     return success;
 }
 
-bool extract_library_node(umbf::Library::Node &node, const acul::path &parent)
+bool extract_mapped(const raw::MappedLayout &layout, const umbf::File &asset, const acul::string &output)
+{
+    acul::vector<char> data;
+    if (!raw::read_mapped_entry(layout, asset, data))
+    {
+        LOG_ERROR("Failed to read mapped entry: %s", output.c_str());
+        return false;
+    }
+    return acul::fs::write_binary(output, data.data(), data.size());
+}
+
+bool extract_library_node(umbf::Library::Node &node, const acul::path &parent, const raw::MappedLayout *layout)
 {
     acul::path path = parent / node.name;
     acul::string str = path.str();
@@ -189,7 +229,7 @@ bool extract_library_node(umbf::Library::Node &node, const acul::path &parent)
             return false;
         }
         for (auto &child : node.children)
-            if (!extract_library_node(child, path)) return false;
+            if (!extract_library_node(child, path, layout)) return false;
     }
     else
     {
@@ -197,7 +237,11 @@ bool extract_library_node(umbf::Library::Node &node, const acul::path &parent)
         switch (node.asset.header.type_sign)
         {
             case umbf::sign_block::format::raw:
-                if (!extract_raw(&node.asset, str)) return false;
+                if (layout)
+                {
+                    if (!extract_mapped(*layout, node.asset, str)) return false;
+                }
+                else if (!extract_raw(&node.asset, str)) return false;
                 break;
             default:
                 if (!node.asset.save(str))
@@ -221,16 +265,18 @@ bool extract_library(umbf::File *file, const acul::string &output)
         return false;
     }
     auto library = acul::static_pointer_cast<umbf::Library>(*it);
+    raw::MappedLayout mapped_layout;
+    const raw::MappedLayout *layout = raw::read_mapped_layout(*file, mapped_layout) ? &mapped_layout : nullptr;
     if (library->file_tree.name.empty() || library->file_tree.name == ".")
     {
         for (auto &child : library->file_tree.children)
-            if (!extract_library_node(child, output)) return false;
+            if (!extract_library_node(child, output, layout)) return false;
         return true;
     }
-    return extract_library_node(library->file_tree, output);
+    return extract_library_node(library->file_tree, output, layout);
 }
 
-bool extract_file(const acul::string &input, const acul::string &output)
+bool extract_file(const acul::string &input, const acul::string &output, const ExtractOptions &options)
 {
     acul::shared_ptr<umbf::File> file;
     auto res = umbf::File::read_from_disk(input, file);
@@ -240,10 +286,10 @@ bool extract_file(const acul::string &input, const acul::string &output)
         return false;
     }
     bool ret = false;
-    switch (file->header.type_sign)
+    switch (raw::base_type(file->header.type_sign))
     {
         case umbf::sign_block::format::raw:
-            ret = extract_raw(file.get(), output);
+            ret = extract_raw(file.get(), output, options);
             break;
         case umbf::sign_block::format::image:
             ret = extract_image(file.get(), output);
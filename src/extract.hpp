@@ -1,4 +1,11 @@
 #pragma once
 #include <acul/string/string.hpp>
 
-bool extract_file(const acul::string &input, const acul::string &output);
\ No newline at end of file
+struct ExtractOptions
+{
+    u64 offset = 0; // Start of the byte range of a raw payload to extract
+    u64 length = 0; // Length of the range, 0 - up to the end
+    u32 jobs = 1;   // Worker threads used to decompress chunked payloads
+};
+
+bool extract_file(const acul::string &input, const acul::string &output, const ExtractOptions &options);
\ No newline at end of file
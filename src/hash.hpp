@@ -0,0 +1,14 @@
+#pragma once
+#include <acul/string/string.hpp>
+
+// 64-bit non-cryptographic hash (XXH64 layout) used to key file contents.
+// Callers that need exact identity must still compare the bytes on a match.
+u64 hash_bytes(const void *data, size_t size, u64 seed = 0);
+
+struct StringHash
+{
+    size_t operator()(const acul::string &value) const
+    {
+        return static_cast<size_t>(hash_bytes(value.c_str(), value.size()));
+    }
+};
@@ -0,0 +1,35 @@
+#include "file_info.hpp"
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+namespace io
+{
+    bool stat_file(const acul::string &path, FileInfo &info)
+    {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return false;
+        info.size = (static_cast<u64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        // FILETIME counts 100 ns intervals
+        const u64 ticks =
+            (static_cast<u64>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+        info.mtime = ticks * 100;
+#else
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+        info.size = static_cast<u64>(st.st_size);
+    #ifdef __APPLE__
+        info.mtime = static_cast<u64>(st.st_mtimespec.tv_sec) * 1000000000ull + st.st_mtimespec.tv_nsec;
+    #else
+        info.mtime = static_cast<u64>(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+    #endif
+#endif
+        return true;
+    }
+} // namespace io
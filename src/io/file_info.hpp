@@ -0,0 +1,13 @@
+#pragma once
+#include <acul/string/string.hpp>
+
+namespace io
+{
+    struct FileInfo
+    {
+        u64 size = 0;
+        u64 mtime = 0; // Last modification time in nanoseconds since the epoch
+    };
+
+    bool stat_file(const acul::string &path, FileInfo &info);
+} // namespace io
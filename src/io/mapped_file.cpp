@@ -0,0 +1,116 @@
+#include "mapped_file.hpp"
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace io
+{
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this == &other) return *this;
+        close();
+        _data = other._data;
+        _size = other._size;
+        other._data = nullptr;
+        other._size = 0;
+#ifdef _WIN32
+        _file = other._file;
+        _mapping = other._mapping;
+        other._file = nullptr;
+        other._mapping = nullptr;
+#endif
+        return *this;
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const acul::string &path)
+    {
+        close();
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        _file = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            close();
+            return false;
+        }
+        _size = static_cast<size_t>(size.QuadPart);
+        if (_size == 0) return true;
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        _mapping = mapping;
+        _data = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!_data)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (_data) UnmapViewOfFile(_data);
+        if (_mapping) CloseHandle(static_cast<HANDLE>(_mapping));
+        if (_file) CloseHandle(static_cast<HANDLE>(_file));
+        _data = nullptr;
+        _mapping = nullptr;
+        _file = nullptr;
+        _size = 0;
+    }
+#else
+    bool MappedFile::open(const acul::string &path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        _size = static_cast<size_t>(st.st_size);
+        if (_size == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+
+        void *ptr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED)
+        {
+            _size = 0;
+            return false;
+        }
+        madvise(ptr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<char *>(ptr);
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if (_data) munmap(_data, _size);
+        _data = nullptr;
+        _size = 0;
+    }
+#endif
+} // namespace io
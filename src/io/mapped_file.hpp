@@ -0,0 +1,35 @@
+#pragma once
+#include <acul/string/string.hpp>
+
+namespace io
+{
+    // Read-only view of a whole file mapped into the address space.
+    // Pages are file-backed, so they are loaded on demand and can be dropped by the kernel under pressure
+    // instead of counting against the process heap.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        bool open(const acul::string &path);
+        void close();
+
+        const char *data() const { return _data; }
+        size_t size() const { return _size; }
+
+    private:
+        char *_data = nullptr;
+        size_t _size = 0;
+#ifdef _WIN32
+        void *_file = nullptr;
+        void *_mapping = nullptr;
+#endif
+    };
+} // namespace io
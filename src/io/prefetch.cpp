@@ -0,0 +1,80 @@
+#include "prefetch.hpp"
+#include <algorithm>
+#include <cstdio>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace io
+{
+    namespace
+    {
+        constexpr u32 max_prefetch_threads = 8;
+
+        void prefetch_file(const char *path)
+        {
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0) return;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            ::close(fd);
+#else
+            // No asynchronous hint: reading the file through on this thread warms the cache just the same
+            FILE *file = fopen(path, "rb");
+            if (!file) return;
+            static thread_local std::vector<char> buffer(1024 * 1024);
+            while (fread(buffer.data(), 1, buffer.size(), file) == buffer.size()) {}
+            fclose(file);
+#endif
+        }
+    } // namespace
+
+    Prefetcher::Prefetcher(size_t count, u32 depth, std::function<const char *(size_t)> path)
+        : _count(count), _depth(depth), _path(std::move(path)), _limit(std::min<size_t>(count, depth))
+    {
+        if (depth == 0 || count == 0) return;
+        const u32 threads = std::min(depth, max_prefetch_threads);
+        _threads.reserve(threads);
+        for (u32 i = 0; i < threads; ++i) _threads.emplace_back([this] { run(); });
+    }
+
+    Prefetcher::~Prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto &thread : _threads) thread.join();
+    }
+
+    void Prefetcher::advance(size_t index)
+    {
+        if (_threads.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const size_t limit = std::min(_count, index + 1 + _depth);
+            if (limit <= _limit) return;
+            _limit = limit;
+            // Entries the workers already reached gain nothing from a hint
+            _next = std::max(_next, index + 1);
+        }
+        _cv.notify_all();
+    }
+
+    void Prefetcher::run()
+    {
+        while (true)
+        {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this] { return _stop || _next < _limit; });
+                if (_stop) return;
+                index = _next++;
+            }
+            if (const char *path = _path(index)) prefetch_file(path);
+        }
+    }
+} // namespace io
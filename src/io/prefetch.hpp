@@ -0,0 +1,41 @@
+#pragma once
+#include <acul/string/string.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace io
+{
+    // Keeps reads of upcoming files in flight while the workers process earlier ones. For every file within
+    // `depth` entries ahead of the furthest one started, a small pool asks the kernel to read it into the page
+    // cache (POSIX_FADV_WILLNEED, which queues the I/O without waiting for it), or reads it through once where no
+    // such hint exists. The later mmap then finds the pages resident instead of faulting them in one by one.
+    class Prefetcher
+    {
+    public:
+        // `path(i)` returns the file of entry i, or nullptr for entries that will not be read
+        Prefetcher(size_t count, u32 depth, std::function<const char *(size_t)> path);
+        ~Prefetcher();
+
+        Prefetcher(const Prefetcher &) = delete;
+        Prefetcher &operator=(const Prefetcher &) = delete;
+
+        // Entry `index` is about to be read; extends the prefetch window past it
+        void advance(size_t index);
+
+    private:
+        size_t _count;
+        size_t _depth;
+        std::function<const char *(size_t)> _path;
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        size_t _next = 0;    // Next entry to prefetch
+        size_t _limit = 0;   // Entries below this may be prefetched
+        bool _stop = false;
+        std::vector<std::thread> _threads;
+
+        void run();
+    };
+} // namespace io
@@ -1,5 +1,6 @@
 #include <acul/log.hpp>
 #include <args.hxx>
+#include <thread>
 #include <umbf/log.hpp>
 #include <umbf/umbf.hpp>
 #include "convert.hpp"
@@ -25,10 +26,27 @@ enum class ConvertFormat
 struct Args
 {
     ArgsCommand command = ArgsCommand::None;
-    acul::string input, output;
+    acul::string input, output, incremental;
     bool compressed = false;
     bool recursive = false;
     bool mapped = false;
+    bool adaptive = false;
+    bool dictionary = false;
+    bool spill = false;
+    bool stream_atlas = false;
+    u32 max_page_size = 0;
+    bool pack_all = false;
+    bool pack_rotate = false;
+    bool trim_sprites = false;
+    bool optimize_meshes = false;
+    bool quantize_meshes = false;
+    u32 dict_size = 112640;
+    f32 min_ratio = 0.95f;
+    u32 jobs = 1;
+    u32 io_depth = 64;
+    u64 chunk_size = 0;
+    u64 solid_size = 0;
+    u64 offset = 0, length = 0;
     ConvertFormat format = ConvertFormat::Raw;
 };
 
@@ -45,9 +63,16 @@ void parse_extract_command(Args &args, args::Subparser &parser)
     args::HelpFlag help(parser, "help", "Show help", {'h', "help"});
     args::ValueFlag<std::string> input(parser, "path", "Input file", {'i', "input"}, args::Options::Required);
     args::ValueFlag<std::string> output(parser, "path", "Output file", {'o', "output"}, args::Options::Required);
+    args::ValueFlag<u64> offset(parser, "bytes", "Start of the raw payload range to extract", {"offset"}, 0);
+    args::ValueFlag<u64> length(parser, "bytes", "Length of the raw payload range to extract", {"length"}, 0);
+    args::ValueFlag<u32> jobs(parser, "N", "Worker threads for chunked payloads (0 - all cores)", {'j', "jobs"}, 1);
     parser.Parse();
     args.input = args::get(input).c_str();
     args.output = args::get(output).c_str();
+    args.offset = args::get(offset);
+    args.length = args::get(length);
+    args.jobs = args::get(jobs);
+    if (args.jobs == 0) args.jobs = std::max(1u, std::thread::hardware_concurrency());
 }
 
 struct __long
@@ -67,6 +92,39 @@ void parse_convert_command(Args &args, args::Subparser &parser)
     args::Flag compressed(parser, "compressed", "Compressed", {"compressed"});
     args::Flag recursive(parser, "recursive", "Recursive directory import", {'R', "recursive"});
     args::Flag mapped(parser, "mapped", "Store raw directory as mapped library", {"mapped"});
+    args::Flag adaptive(parser, "adaptive", "Store entries that do not compress well uncompressed", {"adaptive"});
+    args::ValueFlag<f32> min_ratio(parser, "ratio", "Compressed/original size required by --adaptive (0.95)",
+                                   {"min-ratio"}, 0.95f);
+    args::Flag dictionary(parser, "dictionary", "Compress mapped entries against a trained shared dictionary",
+                          {"dictionary"});
+    args::ValueFlag<u32> dict_size(parser, "bytes", "Maximal size of the --dictionary (112640)", {"dict-size"},
+                                   112640);
+    args::ValueFlag<u64> solid_size(parser, "bytes", "Compress mapped entries together in blocks of this size",
+                                    {"solid"}, 0);
+    args::Flag spill(parser, "spill", "Stream the mapped payload through a temporary file instead of memory",
+                     {"spill"});
+    args::ValueFlag<u64> chunk_size(parser, "bytes", "Compress a raw file in independent chunks of this size",
+                                    {"chunk-size"}, 0);
+    args::ValueFlag<u32> jobs(parser, "N", "Worker threads for raw import, images and meshes (0 - all cores)",
+                              {'j', "jobs"}, 1);
+    args::ValueFlag<u32> io_depth(parser, "N", "Files read ahead of the workers in recursive import (64, 0 - off)",
+                                  {"io-depth"}, 64);
+    args::Flag stream_atlas(parser, "stream-atlas", "Pack atlases from image headers, blit sources one at a time",
+                            {"stream-atlas"});
+    args::ValueFlag<u32> max_page_size(parser, "px", "Side limit of an atlas page, overflow goes to more pages",
+                                       {"max-page-size"}, 0);
+    args::Flag pack_all(parser, "pack-all", "Pack atlases with every heuristic in parallel, keep the smallest",
+                        {"pack-all"});
+    args::Flag pack_rotate(parser, "pack-rotate", "Allow atlas sprites to be rotated by 90 degrees",
+                           {"pack-rotate"});
+    args::Flag trim_sprites(parser, "trim-sprites", "Trim transparent borders of atlas sprites, alias duplicates",
+                            {"trim-sprites"});
+    args::Flag optimize_meshes(parser, "optimize-meshes", "Weld vertices and reorder meshes for the GPU caches",
+                               {"optimize-meshes"});
+    args::Flag quantize_meshes(parser, "quantize-meshes", "Store mesh vertices quantized to 16 bits per component",
+                               {"quantize-meshes"});
+    args::ValueFlag<std::string> incremental(parser, "path", "Reuse unchanged entries of a previous raw library",
+                                             {"incremental"});
     parser.Parse();
     args.input = args::get(input).c_str();
     args.output = args::get(output).c_str();
@@ -77,6 +135,29 @@ void parse_convert_command(Args &args, args::Subparser &parser)
     args.compressed = args::get(compressed);
     args.recursive = args::get(recursive);
     args.mapped = args::get(mapped);
+    args.adaptive = args::get(adaptive);
+    args.min_ratio = args::get(min_ratio);
+    args.dictionary = args::get(dictionary);
+    args.dict_size = args::get(dict_size);
+    if (args.dict_size < 1024) throw args::ValidationError("Invalid --dict-size");
+    if (args.min_ratio <= 0.0f || args.min_ratio > 1.0f) throw args::ValidationError("Invalid --min-ratio");
+    args.jobs = args::get(jobs);
+    if (args.jobs == 0) args.jobs = std::max(1u, std::thread::hardware_concurrency());
+    args.io_depth = args::get(io_depth);
+    args.chunk_size = args::get(chunk_size);
+    args.solid_size = args::get(solid_size);
+    args.spill = args::get(spill);
+    args.stream_atlas = args::get(stream_atlas);
+    args.max_page_size = args::get(max_page_size);
+    if (args.max_page_size > (1u << 29)) throw args::ValidationError("Invalid --max-page-size");
+    args.pack_all = args::get(pack_all);
+    args.pack_rotate = args::get(pack_rotate);
+    args.trim_sprites = args::get(trim_sprites);
+    args.optimize_meshes = args::get(optimize_meshes);
+    args.quantize_meshes = args::get(quantize_meshes);
+    if (args.trim_sprites && args.stream_atlas)
+        throw args::ValidationError("--trim-sprites cannot be combined with --stream-atlas");
+    if (incremental) args.incremental = args::get(incremental).c_str();
 }
 
 bool parse_args(int argc, char **argv, Args &args)
@@ -165,8 +246,14 @@ int main(int argc, char **argv)
                 success = show_file(args.input);
                 break;
             case ArgsCommand::Extract:
-                success = extract_file(args.input, args.output);
-                break;
+            {
+                ExtractOptions options;
+                options.offset = args.offset;
+                options.length = args.length;
+                options.jobs = args.jobs;
+                success = extract_file(args.input, args.output, options);
+            }
+            break;
             case ArgsCommand::Convert:
             {
                 u32 checksum = 0;
@@ -174,9 +261,21 @@ int main(int argc, char **argv)
                 {
                     case ConvertFormat::Raw:
                     {
-                        umbf::File file;
-                        if (convert_raw(args.input, args.compressed, args.recursive, args.mapped, file))
-                            checksum = file.save(args.output) ? file.checksum : 0;
+                        RawOptions options;
+                        options.compressed = args.compressed;
+                        options.recursive = args.recursive;
+                        options.mapped = args.mapped;
+                        options.adaptive = args.adaptive;
+                        options.min_ratio = args.min_ratio;
+                        options.dictionary = args.dictionary;
+                        options.dict_size = args.dict_size;
+                        options.solid_size = args.solid_size;
+                        options.chunk_size = args.chunk_size;
+                        options.jobs = args.jobs;
+                        options.io_depth = args.io_depth;
+                        options.incremental = args.incremental;
+                        options.spill = args.spill;
+                        checksum = convert_raw(args.input, args.output, options);
                         break;
                     }
                     case ConvertFormat::Image:
@@ -187,11 +286,28 @@ int main(int argc, char **argv)
                         break;
                     }
                     case ConvertFormat::Scene:
-                        checksum = convert_scene(args.input, args.output, args.compressed);
+                    {
+                        MeshOptions meshes;
+                        meshes.optimize = args.optimize_meshes;
+                        meshes.quantize = args.quantize_meshes;
+                        checksum = convert_scene(args.input, args.output, args.compressed, meshes, args.jobs);
                         break;
+                    }
                     case ConvertFormat::Json:
-                        checksum = convert_json(args.input, args.output, args.compressed);
+                    {
+                        JsonOptions options;
+                        options.compressed = args.compressed;
+                        options.jobs = args.jobs;
+                        options.stream_atlas = args.stream_atlas;
+                        options.max_page_size = args.max_page_size;
+                        options.pack_all = args.pack_all;
+                        options.pack_rotate = args.pack_rotate;
+                        options.trim_sprites = args.trim_sprites;
+                        options.meshes.optimize = args.optimize_meshes;
+                        options.meshes.quantize = args.quantize_meshes;
+                        checksum = convert_json(args.input, args.output, options);
                         break;
+                    }
                     default:
                         break;
                 }
@@ -0,0 +1,240 @@
+#include "optimize.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include "../hash.hpp"
+
+namespace mesh
+{
+    namespace
+    {
+        // Parameters of Forsyth's vertex scoring
+        constexpr u32 modelled_cache_size = 32;
+        constexpr f32 cache_decay_power = 1.5f;
+        constexpr f32 last_triangle_score = 0.75f;
+        constexpr f32 valence_boost_scale = 2.0f;
+        constexpr f32 valence_boost_power = 0.5f;
+        constexpr u32 no_vertex = ~0u;
+
+        u64 model_bytes(const umbf::Mesh::Model &model)
+        {
+            return model.vertices.size() * sizeof(umbf::Vertex) + model.indices.size() * sizeof(u32);
+        }
+
+        struct VertexHash
+        {
+            const acul::vector<umbf::Vertex> *vertices;
+
+            size_t operator()(u32 index) const
+            {
+                return static_cast<size_t>(hash_bytes(&(*vertices)[index], sizeof(umbf::Vertex)));
+            }
+        };
+
+        struct VertexEqual
+        {
+            const acul::vector<umbf::Vertex> *vertices;
+
+            bool operator()(u32 a, u32 b) const
+            {
+                return memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(umbf::Vertex)) == 0;
+            }
+        };
+
+        // Points every index at the first bitwise identical vertex and drops triangles that collapse
+        void weld(const acul::vector<umbf::Vertex> &vertices, acul::vector<u32> &indices)
+        {
+            std::unordered_map<u32, u32, VertexHash, VertexEqual> first(vertices.size(), VertexHash{&vertices},
+                                                                         VertexEqual{&vertices});
+            acul::vector<u32> remap(vertices.size());
+            for (u32 i = 0; i < vertices.size(); ++i) remap[i] = first.emplace(i, i).first->second;
+
+            size_t kept = 0;
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                const u32 a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+                if (a == b || b == c || a == c) continue;
+                indices[kept++] = a;
+                indices[kept++] = b;
+                indices[kept++] = c;
+            }
+            indices.resize(kept);
+        }
+
+        f32 vertex_score(i32 cache_position, u32 remaining)
+        {
+            if (remaining == 0) return -1.0f;
+            f32 score = 0.0f;
+            if (cache_position >= 0)
+            {
+                // The vertices of the last triangle get a fixed score so the next one does not just reuse its edge
+                if (cache_position < 3) score = last_triangle_score;
+                else
+                {
+                    const f32 scale = 1.0f / static_cast<f32>(modelled_cache_size - 3);
+                    score = std::pow(1.0f - static_cast<f32>(cache_position - 3) * scale, cache_decay_power);
+                }
+            }
+            // Vertices with few triangles left are finished first, so they leave the working set
+            return score + valence_boost_scale * std::pow(static_cast<f32>(remaining), -valence_boost_power);
+        }
+
+        // Greedy triangle ordering after Tom Forsyth, "Linear-Speed Vertex Cache Optimisation". Only triangles of
+        // vertices in the modelled LRU cache are candidates; when none is left the next one in input order starts
+        // a new strip of locality.
+        void optimize_triangle_order(acul::vector<u32> &indices, size_t vertex_count)
+        {
+            const size_t triangle_count = indices.size() / 3;
+            // Live triangles of every vertex, as ranges of one shared list
+            acul::vector<u32> offsets(vertex_count + 1, 0);
+            for (u32 index : indices) ++offsets[index + 1];
+            for (size_t v = 0; v < vertex_count; ++v) offsets[v + 1] += offsets[v];
+            acul::vector<u32> adjacency(indices.size());
+            acul::vector<u32> remaining(vertex_count, 0);
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                const u32 v = indices[i];
+                adjacency[offsets[v] + remaining[v]++] = static_cast<u32>(i / 3);
+            }
+
+            acul::vector<i32> cache_position(vertex_count, -1);
+            acul::vector<f32> score(vertex_count);
+            for (size_t v = 0; v < vertex_count; ++v) score[v] = vertex_score(-1, remaining[v]);
+
+            acul::vector<char> emitted(triangle_count, 0);
+            acul::vector<u32> cache, next_cache;
+            acul::vector<u32> result;
+            result.reserve(indices.size());
+            size_t scan = 0;
+            i64 best = -1;
+            while (result.size() < indices.size())
+            {
+                if (best < 0)
+                {
+                    while (emitted[scan]) ++scan;
+                    best = static_cast<i64>(scan);
+                }
+                const u32 *triangle = &indices[static_cast<size_t>(best) * 3];
+                emitted[best] = 1;
+                result.insert(result.end(), triangle, triangle + 3);
+
+                next_cache.assign(triangle, triangle + 3);
+                for (u32 v : cache)
+                    if (v != triangle[0] && v != triangle[1] && v != triangle[2]) next_cache.push_back(v);
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    const u32 v = triangle[k];
+                    u32 *live = &adjacency[offsets[v]];
+                    for (u32 j = 0; j < remaining[v]; ++j)
+                        if (live[j] == static_cast<u32>(best))
+                        {
+                            live[j] = live[--remaining[v]];
+                            break;
+                        }
+                }
+                for (size_t i = modelled_cache_size; i < next_cache.size(); ++i)
+                {
+                    cache_position[next_cache[i]] = -1;
+                    score[next_cache[i]] = vertex_score(-1, remaining[next_cache[i]]);
+                }
+                if (next_cache.size() > modelled_cache_size) next_cache.resize(modelled_cache_size);
+                std::swap(cache, next_cache);
+                for (size_t i = 0; i < cache.size(); ++i)
+                {
+                    cache_position[cache[i]] = static_cast<i32>(i);
+                    score[cache[i]] = vertex_score(static_cast<i32>(i), remaining[cache[i]]);
+                }
+
+                best = -1;
+                f32 best_score = -1.0f;
+                for (u32 v : cache)
+                    for (u32 j = 0; j < remaining[v]; ++j)
+                    {
+                        const u32 t = adjacency[offsets[v] + j];
+                        const f32 value = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                        if (value > best_score)
+                        {
+                            best_score = value;
+                            best = t;
+                        }
+                    }
+            }
+            indices = std::move(result);
+        }
+
+        // Renumbers vertices in the order of their first use and drops the unused ones
+        void optimize_vertex_fetch(acul::vector<umbf::Vertex> &vertices, acul::vector<u32> &indices)
+        {
+            acul::vector<u32> remap(vertices.size(), no_vertex);
+            acul::vector<umbf::Vertex> ordered;
+            ordered.reserve(vertices.size());
+            for (auto &index : indices)
+            {
+                if (remap[index] == no_vertex)
+                {
+                    remap[index] = static_cast<u32>(ordered.size());
+                    ordered.push_back(vertices[index]);
+                }
+                index = remap[index];
+            }
+            vertices = std::move(ordered);
+        }
+    } // namespace
+
+    void OptimizeStats::add(const OptimizeStats &other)
+    {
+        triangles_before += other.triangles_before;
+        triangles_after += other.triangles_after;
+        transforms_before += other.transforms_before;
+        transforms_after += other.transforms_after;
+        bytes_before += other.bytes_before;
+        bytes_after += other.bytes_after;
+    }
+
+    u64 cache_misses(const acul::vector<u32> &indices, size_t vertex_count, u32 cache_size)
+    {
+        // A vertex is still cached while fewer than `cache_size` misses happened since it was loaded
+        acul::vector<u64> loaded(vertex_count, 0);
+        u64 timestamp = cache_size + 1;
+        u64 misses = 0;
+        for (u32 index : indices)
+        {
+            if (timestamp - loaded[index] <= cache_size) continue;
+            loaded[index] = timestamp++;
+            ++misses;
+        }
+        return misses;
+    }
+
+    void optimize(umbf::Mesh &mesh, OptimizeStats &stats)
+    {
+        auto &model = mesh.model;
+        const u64 bytes = model_bytes(model);
+        stats.bytes_before += bytes;
+        const bool indexed = !model.indices.empty();
+        const size_t corners = indexed ? model.indices.size() : model.vertices.size();
+        const bool valid = corners % 3 == 0 && std::all_of(model.indices.begin(), model.indices.end(),
+                                                           [&](u32 index) { return index < model.vertices.size(); });
+        if (!valid)
+        {
+            // Left as it is, nothing can be said about its triangles
+            stats.bytes_after += bytes;
+            return;
+        }
+        if (!indexed)
+        {
+            model.indices.resize(model.vertices.size());
+            for (size_t i = 0; i < model.indices.size(); ++i) model.indices[i] = static_cast<u32>(i);
+        }
+
+        stats.triangles_before += model.indices.size() / 3;
+        stats.transforms_before += cache_misses(model.indices, model.vertices.size());
+        weld(model.vertices, model.indices);
+        optimize_triangle_order(model.indices, model.vertices.size());
+        optimize_vertex_fetch(model.vertices, model.indices);
+        stats.triangles_after += model.indices.size() / 3;
+        stats.transforms_after += cache_misses(model.indices, model.vertices.size());
+        stats.bytes_after += model_bytes(model);
+    }
+} // namespace mesh
@@ -0,0 +1,37 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace mesh
+{
+    // Size of the FIFO vertex cache ACMR is measured against, a common figure for current GPUs
+    constexpr u32 acmr_cache_size = 16;
+
+    struct OptimizeStats
+    {
+        u64 triangles_before = 0, triangles_after = 0;
+        u64 transforms_before = 0, transforms_after = 0; // Simulated vertex cache misses
+        u64 bytes_before = 0, bytes_after = 0;           // Vertex plus index data
+
+        void add(const OptimizeStats &other);
+
+        f64 acmr_before() const { return acmr(transforms_before, triangles_before); }
+        f64 acmr_after() const { return acmr(transforms_after, triangles_after); }
+
+    private:
+        static f64 acmr(u64 transforms, u64 triangles)
+        {
+            return triangles ? static_cast<f64>(transforms) / static_cast<f64>(triangles) : 0.0;
+        }
+    };
+
+    // Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache of
+    // `cache_size` entries. 0.5 is the ideal for large regular meshes, 3 means no reuse at all.
+    u64 cache_misses(const acul::vector<u32> &indices, size_t vertex_count, u32 cache_size = acmr_cache_size);
+
+    // Rebuilds the mesh for the GPU in place:
+    // - welds bitwise identical vertices and drops degenerate triangles and unreferenced vertices;
+    // - reorders triangles for the post-transform vertex cache (Forsyth's linear-speed optimizer);
+    // - renumbers vertices in the order the triangles first use them, so fetches walk memory forward.
+    // Non-indexed meshes get an index buffer. The rendered result is unchanged.
+    void optimize(umbf::Mesh &mesh, OptimizeStats &stats);
+} // namespace mesh
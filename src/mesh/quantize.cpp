@@ -0,0 +1,164 @@
+#include "quantize.hpp"
+#include <algorithm>
+#include <cmath>
+#include "../raw/aux.hpp"
+
+namespace mesh
+{
+    namespace
+    {
+        constexpr u32 quantized_version = 2;
+        constexpr f32 unorm16_max = 65535.0f;
+        constexpr f32 snorm16_max = 32767.0f;
+
+        // Step of a unorm16 range covering [min, max]. A flat range gets step 0, every value dequantizes to min.
+        f32 unorm16_step(f32 min, f32 max) { return max > min ? (max - min) / unorm16_max : 0.0f; }
+
+        u16 to_unorm16(f32 value, f32 min, f32 step)
+        {
+            if (step == 0.0f) return 0;
+            return static_cast<u16>(std::clamp(std::lround((value - min) / step), 0l, 65535l));
+        }
+
+        i16 to_snorm16(f32 value)
+        {
+            return static_cast<i16>(std::lround(std::clamp(value, -1.0f, 1.0f) * snorm16_max));
+        }
+
+        f32 sign_not_zero(f32 value) { return value < 0.0f ? -1.0f : 1.0f; }
+
+        // Projects the unit sphere onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half into the
+        // corners of the square
+        void encode_octahedral(const amal::vec3 &normal, i16 out[2])
+        {
+            const f32 length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if (length == 0.0f)
+            {
+                out[0] = out[1] = 0;
+                return;
+            }
+            f32 x = normal.x / length, y = normal.y / length;
+            if (normal.z < 0.0f)
+            {
+                const f32 folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+                y = (1.0f - std::abs(x)) * sign_not_zero(y);
+                x = folded_x;
+            }
+            out[0] = to_snorm16(x);
+            out[1] = to_snorm16(y);
+        }
+
+        amal::vec3 decode_octahedral(const i16 in[2])
+        {
+            f32 x = std::max(static_cast<f32>(in[0]) / snorm16_max, -1.0f);
+            f32 y = std::max(static_cast<f32>(in[1]) / snorm16_max, -1.0f);
+            const f32 z = 1.0f - std::abs(x) - std::abs(y);
+            if (z < 0.0f)
+            {
+                const f32 unfolded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+                y = (1.0f - std::abs(x)) * sign_not_zero(y);
+                x = unfolded_x;
+            }
+            const f32 length = std::sqrt(x * x + y * y + z * z);
+            if (length == 0.0f) return {0.0f, 0.0f, 0.0f};
+            return {x / length, y / length, z / length};
+        }
+
+        umbf::Mesh *find_mesh(umbf::Object &object)
+        {
+            for (auto &block : object.meta)
+                if (block->signature() == umbf::sign_block::mesh) return static_cast<umbf::Mesh *>(block.get());
+            return nullptr;
+        }
+    } // namespace
+
+    void quantize(const acul::vector<umbf::Vertex> &vertices, QuantizedMesh &mesh)
+    {
+        amal::vec3 min{0.0f, 0.0f, 0.0f}, max{0.0f, 0.0f, 0.0f};
+        amal::vec2 uv_min{0.0f, 0.0f}, uv_max{0.0f, 0.0f};
+        if (!vertices.empty())
+        {
+            min = max = vertices.front().pos;
+            uv_min = uv_max = vertices.front().uv;
+        }
+        for (const auto &vertex : vertices)
+        {
+            min = {std::min(min.x, vertex.pos.x), std::min(min.y, vertex.pos.y), std::min(min.z, vertex.pos.z)};
+            max = {std::max(max.x, vertex.pos.x), std::max(max.y, vertex.pos.y), std::max(max.z, vertex.pos.z)};
+            uv_min = {std::min(uv_min.x, vertex.uv.x), std::min(uv_min.y, vertex.uv.y)};
+            uv_max = {std::max(uv_max.x, vertex.uv.x), std::max(uv_max.y, vertex.uv.y)};
+        }
+        mesh.position_min = min;
+        mesh.position_step = {unorm16_step(min.x, max.x), unorm16_step(min.y, max.y), unorm16_step(min.z, max.z)};
+        mesh.uv_min = uv_min;
+        mesh.uv_step = {unorm16_step(uv_min.x, uv_max.x), unorm16_step(uv_min.y, uv_max.y)};
+
+        mesh.vertices.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i)
+        {
+            const auto &vertex = vertices[i];
+            auto &out = mesh.vertices[i];
+            out.position[0] = to_unorm16(vertex.pos.x, min.x, mesh.position_step.x);
+            out.position[1] = to_unorm16(vertex.pos.y, min.y, mesh.position_step.y);
+            out.position[2] = to_unorm16(vertex.pos.z, min.z, mesh.position_step.z);
+            encode_octahedral(vertex.normal, out.normal);
+            out.uv[0] = to_unorm16(vertex.uv.x, uv_min.x, mesh.uv_step.x);
+            out.uv[1] = to_unorm16(vertex.uv.y, uv_min.y, mesh.uv_step.y);
+        }
+    }
+
+    void dequantize(const QuantizedMesh &mesh, acul::vector<umbf::Vertex> &vertices)
+    {
+        vertices.resize(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            const auto &in = mesh.vertices[i];
+            auto &vertex = vertices[i];
+            vertex.pos = {mesh.position_min.x + in.position[0] * mesh.position_step.x,
+                          mesh.position_min.y + in.position[1] * mesh.position_step.y,
+                          mesh.position_min.z + in.position[2] * mesh.position_step.z};
+            vertex.normal = decode_octahedral(in.normal);
+            vertex.uv = {mesh.uv_min.x + in.uv[0] * mesh.uv_step.x, mesh.uv_min.y + in.uv[1] * mesh.uv_step.y};
+        }
+    }
+
+    bool quantize_object(umbf::Object &object)
+    {
+        auto *mesh = find_mesh(object);
+        if (!mesh || mesh->model.vertices.empty()) return false;
+        QuantizedMesh quantized;
+        quantize(mesh->model.vertices, quantized);
+
+        raw::ByteWriter writer;
+        writer.write(quantized_version);
+        writer.write(static_cast<u64>(quantized.vertices.size()));
+        writer.write(quantized.position_min);
+        writer.write(quantized.position_step);
+        writer.write(quantized.uv_min);
+        writer.write(quantized.uv_step);
+        writer.write(quantized.vertices.data(), quantized.vertices.size() * sizeof(QuantizedVertex));
+        raw::append_aux_blocks(object.meta, {raw::make_aux_block(raw::aux_tag::mesh_vertices, writer.data())});
+        mesh->model.vertices.clear();
+        mesh->model.vertices.shrink_to_fit();
+        return true;
+    }
+
+    bool dequantize_object(umbf::Object &object)
+    {
+        raw::ByteReader reader;
+        if (!raw::find_aux_block(object.meta, raw::aux_tag::mesh_vertices, reader)) return true;
+        auto *mesh = find_mesh(object);
+        u32 version;
+        u64 count;
+        QuantizedMesh quantized;
+        if (!mesh || !reader.read(version) || version != quantized_version || !reader.read(count)) return false;
+        if (!reader.read(quantized.position_min) || !reader.read(quantized.position_step) ||
+            !reader.read(quantized.uv_min) || !reader.read(quantized.uv_step))
+            return false;
+        if (count != reader.remaining() / sizeof(QuantizedVertex)) return false;
+        quantized.vertices.resize(count);
+        if (!reader.read(quantized.vertices.data(), count * sizeof(QuantizedVertex))) return false;
+        dequantize(quantized, mesh->model.vertices);
+        return true;
+    }
+} // namespace mesh
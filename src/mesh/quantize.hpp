@@ -0,0 +1,35 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace mesh
+{
+    // Compact vertex of a quantized mesh, 14 bytes instead of the 32 of umbf::Vertex
+    struct QuantizedVertex
+    {
+        u16 position[3]; // Unorm16 within the bounds of the mesh
+        i16 normal[2];   // Snorm16 octahedral encoding of the unit normal
+        u16 uv[2];       // Unorm16 within the UV bounds of the mesh
+    };
+    static_assert(sizeof(QuantizedVertex) == 14, "quantized vertices are stored packed");
+
+    // Dequantization: value = min + q * step for positions and UVs
+    struct QuantizedMesh
+    {
+        amal::vec3 position_min, position_step;
+        amal::vec2 uv_min, uv_step;
+        acul::vector<QuantizedVertex> vertices;
+    };
+
+    void quantize(const acul::vector<umbf::Vertex> &vertices, QuantizedMesh &mesh);
+
+    void dequantize(const QuantizedMesh &mesh, acul::vector<umbf::Vertex> &vertices);
+
+    // Replaces the float vertices of the object's mesh by a quantized copy stored in an auxiliary meta block
+    // after it. The mesh block keeps its indices, so the file must be marked as extended (raw/format.hpp).
+    // Returns false if the object has no mesh with vertices.
+    bool quantize_object(umbf::Object &object);
+
+    // Restores float vertices of an object written by quantize_object, for consumers that only understand
+    // umbf::Vertex. Objects without a quantized block are left alone; returns false if the block is damaged.
+    bool dequantize_object(umbf::Object &object);
+} // namespace mesh
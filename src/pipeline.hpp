@@ -0,0 +1,139 @@
+#pragma once
+#include <acul/string/string.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Runs produce(i) for every i in [0, count) on `jobs` worker threads and passes each result to consume(i, result)
+// on the calling thread, strictly in index order. Workers never run more than a fixed window ahead of the consumer,
+// so the number of results held in memory is bounded regardless of count.
+// Stops early and returns false as soon as consume() returns false. An exception thrown by produce() or consume()
+// stops the run as well and is rethrown on the calling thread once the workers have been joined.
+template <typename T, typename Produce, typename Consume>
+bool run_ordered(size_t count, u32 jobs, Produce &&produce, Consume &&consume)
+{
+    if (jobs <= 1 || count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            T value = produce(i);
+            if (!consume(i, value)) return false;
+        }
+        return true;
+    }
+
+    const size_t window = static_cast<size_t>(jobs) * 4;
+    std::vector<std::optional<T>> slots(window);
+    std::vector<std::exception_ptr> errors(window); // Set instead of the slot when produce() throws
+    std::mutex mutex;
+    std::condition_variable produced_cv, consumed_cv;
+    size_t next = 0, consumed = 0;
+    bool stop = false;
+
+    auto worker = [&]() {
+        while (true)
+        {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                consumed_cv.wait(lock, [&] { return stop || next >= count || next < consumed + window; });
+                if (stop || next >= count) return;
+                index = next++;
+            }
+            std::optional<T> value;
+            std::exception_ptr error;
+            try
+            {
+                value.emplace(produce(index));
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error) errors[index % window] = error;
+                else slots[index % window] = std::move(value);
+            }
+            produced_cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(jobs);
+    for (u32 i = 0; i < jobs; ++i) threads.emplace_back(worker);
+
+    bool ok = true;
+    std::exception_ptr error;
+    for (size_t i = 0; i < count && ok && !error; ++i)
+    {
+        std::optional<T> value;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            produced_cv.wait(lock, [&] { return slots[i % window].has_value() || errors[i % window]; });
+            error = errors[i % window];
+            value = std::move(slots[i % window]);
+            slots[i % window].reset();
+            consumed = i + 1;
+        }
+        consumed_cv.notify_all();
+        if (error) break;
+        try
+        {
+            ok = consume(i, *value);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    consumed_cv.notify_all();
+    for (auto &thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+    return ok;
+}
+
+// Runs fn(i) for every i in [0, count) on `jobs` threads, in no particular order. The first exception thrown by fn
+// stops the remaining indices from being started and is rethrown on the calling thread after all threads are done.
+template <typename Fn>
+void parallel_for(size_t count, u32 jobs, Fn &&fn)
+{
+    if (jobs <= 1 || count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::exception_ptr error;
+    auto worker = [&]() {
+        try
+        {
+            for (size_t i = next++; i < count; i = next++) fn(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+            next = count;
+        }
+    };
+    const u32 threads_count = static_cast<u32>(std::min<size_t>(jobs, count));
+    std::vector<std::thread> threads;
+    threads.reserve(threads_count - 1);
+    for (u32 i = 1; i < threads_count; ++i) threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,133 @@
+#include "atlas.hpp"
+#include <cstring>
+#include "../pipeline.hpp"
+#include "../raw/aux.hpp"
+
+namespace pixels
+{
+    namespace
+    {
+        constexpr size_t rows_per_band = 64;
+        constexpr u32 page_table_version = 1;
+
+        struct Blit
+        {
+            const u8 *pixels;
+            i64 x, y, width, height; // Sprite area in the atlas
+        };
+
+        void fill_row(u8 *row, i64 atlas_width, const Blit &blit, i64 y, i64 padding, size_t pixel_size)
+        {
+            const i64 source_y = std::clamp<i64>(y - blit.y, 0, blit.height - 1);
+            const u8 *source = blit.pixels + static_cast<size_t>(source_y * blit.width) * pixel_size;
+            const i64 begin = std::max<i64>(blit.x - padding, 0);
+            const i64 end = std::min<i64>(blit.x + blit.width + padding, atlas_width);
+            const i64 copy_begin = std::max(begin, blit.x), copy_end = std::min(end, blit.x + blit.width);
+            for (i64 x = begin; x < copy_begin; ++x) memcpy(row + x * pixel_size, source, pixel_size);
+            if (copy_end > copy_begin)
+                memcpy(row + copy_begin * pixel_size, source + (copy_begin - blit.x) * pixel_size,
+                       static_cast<size_t>(copy_end - copy_begin) * pixel_size);
+            const u8 *last = source + (blit.width - 1) * pixel_size;
+            for (i64 x = std::max(copy_end, begin); x < end; ++x) memcpy(row + x * pixel_size, last, pixel_size);
+        }
+    } // namespace
+
+    acul::shared_ptr<umbf::RawBlock> write_page_table(const AtlasPageTable &table)
+    {
+        raw::ByteWriter writer;
+        writer.write(page_table_version);
+        writer.write(table.pages);
+        writer.write(static_cast<u64>(table.page_of.size()));
+        for (u32 page : table.page_of) writer.write(page);
+        return raw::make_aux_block(raw::aux_tag::atlas_pages, writer.data());
+    }
+
+    bool read_page_table(const umbf::File &file, AtlasPageTable &table)
+    {
+        raw::ByteReader reader;
+        if (!raw::find_aux_block(file, raw::aux_tag::atlas_pages, reader)) return false;
+        u32 version;
+        u64 count;
+        if (!reader.read(version) || version != page_table_version) return false;
+        if (!reader.read(table.pages) || !reader.read(count) || count > reader.remaining() / sizeof(u32)) return false;
+        table.page_of.resize(count);
+        return reader.read(table.page_of.data(), count * sizeof(u32));
+    }
+
+    void fill_atlas(umbf::Image2D &image, const umbf::Atlas &atlas,
+                    const acul::vector<acul::shared_ptr<umbf::Image2D>> &sprites, u32 jobs)
+    {
+        const size_t pixel_size = image.channels.size() * image.format.bytes_per_channel;
+        const size_t row_size = static_cast<size_t>(image.width) * pixel_size;
+        u8 *pixels = acul::alloc_n<u8>(row_size * image.height);
+        image.pixels = pixels;
+
+        const i64 padding = atlas.padding;
+        acul::vector<Blit> blits;
+        blits.reserve(sprites.size());
+        for (size_t i = 0; i < sprites.size() && i < atlas.pack_data.size(); ++i)
+        {
+            const auto &rect = atlas.pack_data[i];
+            if (!sprites[i]) continue;
+            if (rect.size.x <= 0 || rect.size.y <= 0 || rect.pos.x < 0 || rect.pos.y < 0) continue;
+            blits.push_back({static_cast<const u8 *>(sprites[i]->pixels), rect.pos.x, rect.pos.y, rect.size.x,
+                             rect.size.y});
+        }
+
+        const size_t bands = (static_cast<size_t>(image.height) + rows_per_band - 1) / rows_per_band;
+        parallel_for(bands, jobs, [&](size_t band) {
+            const i64 first = static_cast<i64>(band * rows_per_band);
+            const i64 last = std::min<i64>(first + rows_per_band, image.height);
+            u8 *band_pixels = pixels + static_cast<size_t>(first) * row_size;
+            memset(band_pixels, 0, static_cast<size_t>(last - first) * row_size);
+            for (const auto &blit : blits)
+            {
+                const i64 begin = std::max(first, blit.y - padding);
+                const i64 end = std::min(last, blit.y + blit.height + padding);
+                for (i64 y = begin; y < end; ++y)
+                    fill_row(pixels + static_cast<size_t>(y) * row_size, image.width, blit, y, padding, pixel_size);
+            }
+        });
+    }
+
+    acul::shared_ptr<umbf::Image2D> rotate_sprite(const umbf::Image2D &sprite)
+    {
+        auto rotated = acul::make_shared<umbf::Image2D>(sprite);
+        rotated->width = sprite.height;
+        rotated->height = sprite.width;
+        const size_t pixel_size = sprite.channels.size() * sprite.format.bytes_per_channel;
+        const u8 *source = static_cast<const u8 *>(sprite.pixels);
+        u8 *pixels = acul::alloc_n<u8>(static_cast<size_t>(sprite.width) * sprite.height * pixel_size);
+        // Row y of the rotated sprite is column y of the source, read bottom to top
+        for (size_t y = 0; y < rotated->height; ++y)
+            for (size_t x = 0; x < rotated->width; ++x)
+                memcpy(pixels + (y * rotated->width + x) * pixel_size,
+                       source + ((sprite.height - 1 - x) * sprite.width + y) * pixel_size, pixel_size);
+        rotated->pixels = pixels;
+        return rotated;
+    }
+
+    void allocate_atlas(umbf::Image2D &image)
+    {
+        const size_t size = static_cast<size_t>(image.width) * image.height * image.channels.size() *
+                            image.format.bytes_per_channel;
+        u8 *pixels = acul::alloc_n<u8>(size);
+        memset(pixels, 0, size);
+        image.pixels = pixels;
+    }
+
+    void blit_sprite(umbf::Image2D &image, const umbf::Atlas &atlas, const amal::irect &rect,
+                     const umbf::Image2D &sprite)
+    {
+        if (rect.size.x <= 0 || rect.size.y <= 0 || rect.pos.x < 0 || rect.pos.y < 0) return;
+        const size_t pixel_size = image.channels.size() * image.format.bytes_per_channel;
+        const size_t row_size = static_cast<size_t>(image.width) * pixel_size;
+        const i64 padding = atlas.padding;
+        const Blit blit{static_cast<const u8 *>(sprite.pixels), rect.pos.x, rect.pos.y, rect.size.x, rect.size.y};
+        u8 *pixels = static_cast<u8 *>(image.pixels);
+        const i64 begin = std::max<i64>(blit.y - padding, 0);
+        const i64 end = std::min<i64>(blit.y + blit.height + padding, image.height);
+        for (i64 y = begin; y < end; ++y)
+            fill_row(pixels + static_cast<size_t>(y) * row_size, image.width, blit, y, padding, pixel_size);
+    }
+} // namespace pixels
@@ -0,0 +1,45 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace pixels
+{
+    // Page of every sprite of a multi-page atlas. The pages are stored as consecutive Image2D/Atlas block pairs,
+    // each with the pack_data of all sprites, where sprites of other pages sit at (-1, -1). The table follows them
+    // in an auxiliary block; single-page atlases have none.
+    struct AtlasPageTable
+    {
+        u32 pages = 1;
+        acul::vector<u32> page_of; // Indexed like pack_data
+    };
+
+    acul::shared_ptr<umbf::RawBlock> write_page_table(const AtlasPageTable &table);
+
+    bool read_page_table(const umbf::File &file, AtlasPageTable &table);
+
+    // Allocates the pixels of `image` and blits the packed sprites into it on `jobs` threads. The atlas is split
+    // into bands of rows, each filled by one thread: background, sprite rows with one memcpy each, and the
+    // padding ring around every sprite, which repeats its edge pixels so filtering never samples a neighbour.
+    // Sprites must already be in the format of the atlas; pack_data positions are their top-left corners.
+    // Null sprites are skipped, e.g. aliases that share the rect of an earlier sprite.
+    void fill_atlas(umbf::Image2D &image, const umbf::Atlas &atlas,
+                    const acul::vector<acul::shared_ptr<umbf::Image2D>> &sprites, u32 jobs);
+
+    // Whether the packer rotated the sprite into `rect`: its size is the sprite's with width and height swapped
+    inline bool is_rotated(const amal::irect &rect, const umbf::Image2D &sprite)
+    {
+        return sprite.width != sprite.height && rect.size.x == static_cast<i32>(sprite.height) &&
+               rect.size.y == static_cast<i32>(sprite.width);
+    }
+
+    // Copy of `sprite` rotated 90 degrees clockwise, as rotated sprites are stored in the atlas. The caller owns
+    // the new pixels.
+    acul::shared_ptr<umbf::Image2D> rotate_sprite(const umbf::Image2D &sprite);
+
+    // Allocates the pixels of `image` cleared to zero, for atlases filled one sprite at a time with blit_sprite
+    void allocate_atlas(umbf::Image2D &image);
+
+    // Blits a single sprite and its padding ring into an allocated atlas at `rect`. Produces the same pixels as
+    // fill_atlas as long as sprites are blitted in pack_data order.
+    void blit_sprite(umbf::Image2D &image, const umbf::Atlas &atlas, const amal::irect &rect,
+                     const umbf::Image2D &sprite);
+} // namespace pixels
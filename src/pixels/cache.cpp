@@ -0,0 +1,89 @@
+#include "cache.hpp"
+#include <acul/log.hpp>
+#include <aecl/image/import.hpp>
+#include <umbf/utils.hpp>
+#include "../io/file_info.hpp"
+#include "kernels.hpp"
+
+namespace pixels
+{
+    acul::shared_ptr<umbf::Image2D> decode_image(const acul::string &path)
+    {
+        auto importer = aecl::image::get_importer_by_path(path);
+        acul::vector<umbf::Image2D> images;
+        acul::shared_ptr<umbf::Image2D> image;
+        if (importer)
+        {
+            if (importer->load(path, images)) image = acul::make_shared<umbf::Image2D>(images.front());
+            else LOG_ERROR("AECL error: %s", importer->error().c_str());
+            acul::release(importer);
+        }
+        return image;
+    }
+
+    acul::shared_ptr<umbf::Image2D> convert_image(const umbf::Image2D &source, const acul::string &path,
+                                                  const umbf::ImageFormat &format, size_t channels)
+    {
+        LOG_INFO("Converting image to the atlas format: %s", path.c_str());
+        auto image = acul::make_shared<umbf::Image2D>(source);
+        // Common cases go through the vectorized kernels, anything else through the generic converter
+        void *converted = pixels::convert(source, format, channels);
+        if (!converted) converted = umbf::utils::convert_image(source, format, channels);
+        image->pixels = converted;
+        image->format = format;
+        return image;
+    }
+
+    ImageCache::~ImageCache()
+    {
+        for (auto &[key, entry] : _entries)
+        {
+            if (entry->image && entry->image->pixels) acul::release(entry->image->pixels);
+            for (auto &variant : entry->variants)
+                if (variant.entry->image && variant.entry->image->pixels) acul::release(variant.entry->image->pixels);
+        }
+    }
+
+    acul::shared_ptr<ImageCache::Entry> ImageCache::source(const acul::string &path)
+    {
+        // A file that cannot be stated keeps zeros and fails to decode
+        io::FileInfo info;
+        io::stat_file(path, info);
+        const acul::string key = acul::format("%s|%llu|%llu", path.c_str(), static_cast<unsigned long long>(info.mtime),
+                                              static_cast<unsigned long long>(info.size));
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto &slot = _entries[key];
+        if (!slot) slot = acul::make_shared<Entry>();
+        return slot;
+    }
+
+    acul::shared_ptr<umbf::Image2D> ImageCache::load(const acul::string &path)
+    {
+        auto entry = source(path);
+        std::call_once(entry->once, [&] { entry->image = decode_image(path); });
+        return entry->image;
+    }
+
+    acul::shared_ptr<umbf::Image2D> ImageCache::load(const acul::string &path, const umbf::ImageFormat &format,
+                                                     size_t channels)
+    {
+        auto entry = source(path);
+        std::call_once(entry->once, [&] { entry->image = decode_image(path); });
+        const auto &image = entry->image;
+        if (!image || (image->channels.size() == channels && !(image->format != format))) return image;
+
+        acul::shared_ptr<Entry> converted;
+        {
+            std::lock_guard<std::mutex> lock(entry->variants_lock);
+            for (const auto &variant : entry->variants)
+                if (variant.channels == channels && !(variant.format != format)) converted = variant.entry;
+            if (!converted)
+            {
+                converted = acul::make_shared<Entry>();
+                entry->variants.push_back({format, channels, converted});
+            }
+        }
+        std::call_once(converted->once, [&] { converted->image = convert_image(*image, path, format, channels); });
+        return converted->image;
+    }
+} // namespace pixels
@@ -0,0 +1,62 @@
+#pragma once
+#include <mutex>
+#include <umbf/umbf.hpp>
+#include <unordered_map>
+#include "../hash.hpp"
+
+namespace pixels
+{
+    // Decodes the image at `path`, returns nullptr on failure. The caller owns the pixels.
+    acul::shared_ptr<umbf::Image2D> decode_image(const acul::string &path);
+
+    // Copy of `source` converted to `format` with `channels` channels, `path` is only used for logging.
+    // The caller owns the new pixels; the source ones are left untouched.
+    acul::shared_ptr<umbf::Image2D> convert_image(const umbf::Image2D &source, const acul::string &path,
+                                                  const umbf::ImageFormat &format, size_t channels);
+
+    // Decoded source images of one conversion run. Entries are keyed by path, modification time and size, and
+    // keep their converted variants per target format, so every source is decoded and converted at most once no matter
+    // how often manifests reference it. Safe to use from several threads; concurrent requests for the same
+    // entry wait for a single decode.
+    // Returned images share their pixels with the cache, which releases them when it is destroyed, so it must
+    // outlive saving every file that uses them.
+    class ImageCache
+    {
+    public:
+        ImageCache() = default;
+        ~ImageCache();
+
+        ImageCache(const ImageCache &) = delete;
+        ImageCache &operator=(const ImageCache &) = delete;
+
+        // Returns nullptr if the image cannot be decoded
+        acul::shared_ptr<umbf::Image2D> load(const acul::string &path);
+
+        // The image converted to `format` with `channels` channels
+        acul::shared_ptr<umbf::Image2D> load(const acul::string &path, const umbf::ImageFormat &format,
+                                             size_t channels);
+
+    private:
+        struct Entry;
+
+        struct Variant
+        {
+            umbf::ImageFormat format;
+            size_t channels;
+            acul::shared_ptr<Entry> entry;
+        };
+
+        struct Entry
+        {
+            std::once_flag once;
+            acul::shared_ptr<umbf::Image2D> image;
+            std::mutex variants_lock;
+            acul::vector<Variant> variants; // Converted copies of the image
+        };
+
+        std::mutex _mutex;
+        std::unordered_map<acul::string, acul::shared_ptr<Entry>, StringHash> _entries;
+
+        acul::shared_ptr<Entry> source(const acul::string &path);
+    };
+} // namespace pixels
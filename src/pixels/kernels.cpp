@@ -0,0 +1,346 @@
+#include "kernels.hpp"
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define PIXELS_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// GCC and Clang compile each SIMD kernel for its own instruction set, so the rest of the binary keeps the
+// baseline target. MSVC accepts the intrinsics without it.
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define PIXELS_TARGET(features)
+#else
+    #define PIXELS_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace pixels
+{
+    namespace
+    {
+        constexpr f32 u8_scale = 1.0f / 255.0f;
+
+        void u8_to_f32_scalar(const u8 *src, f32 *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) dst[i] = static_cast<f32>(src[i]) * u8_scale;
+        }
+
+        void rgb_to_rgba_u8_scalar(const u8 *src, u8 *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i, src += 3, dst += 4)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 0xFF;
+            }
+        }
+
+        void rgb_to_rgba_f32_scalar(const f32 *src, f32 *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i, src += 3, dst += 4)
+            {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = 1.0f;
+            }
+        }
+
+        // Bit-exact with the F16C instruction: round to nearest even, subnormals kept, NaNs quieted
+        u16 f32_to_f16_value(f32 value)
+        {
+            u32 bits;
+            memcpy(&bits, &value, sizeof(bits));
+            const u32 sign = (bits >> 16) & 0x8000;
+            const u32 abs = bits & 0x7FFFFFFF;
+            if (abs > 0x7F800000) return static_cast<u16>(sign | 0x7E00 | ((abs >> 13) & 0x3FF));
+            if (abs >= 0x477FF000) return static_cast<u16>(sign | 0x7C00); // Rounds past 65504
+            if (abs < 0x38800000)
+            {
+                // Subnormal half: the implicit one becomes explicit and the mantissa is shifted into place
+                if (abs < 0x33000000) return static_cast<u16>(sign);
+                const u32 shift = 126 - (abs >> 23);
+                const u32 mantissa = (abs & 0x7FFFFF) | 0x800000;
+                u32 half = mantissa >> shift;
+                const u32 rest = mantissa & ((1u << shift) - 1);
+                const u32 halfway = 1u << (shift - 1);
+                if (rest > halfway || (rest == halfway && (half & 1))) ++half;
+                return static_cast<u16>(sign | half);
+            }
+            // Rebias the exponent from 127 to 15; a carry out of the mantissa correctly bumps the exponent
+            u32 half = (abs - 0x38000000) >> 13;
+            const u32 rest = abs & 0x1FFF;
+            if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half;
+            return static_cast<u16>(sign | half);
+        }
+
+        void f32_to_f16_scalar(const f32 *src, u16 *dst, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i) dst[i] = f32_to_f16_value(src[i]);
+        }
+
+#ifdef PIXELS_X86
+        PIXELS_TARGET("sse2")
+        void u8_to_f32_sse2(const u8 *src, f32 *dst, size_t count)
+        {
+            const __m128 scale = _mm_set1_ps(u8_scale);
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+                _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+                _mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+                _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+            }
+            u8_to_f32_scalar(src + i, dst + i, count - i);
+        }
+
+        PIXELS_TARGET("avx2")
+        void u8_to_f32_avx2(const u8 *src, f32 *dst, size_t count)
+        {
+            const __m256 scale = _mm256_set1_ps(u8_scale);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+                const __m256i low = _mm256_cvtepu8_epi32(bytes);
+                const __m256i high = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(low), scale));
+                _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(high), scale));
+            }
+            u8_to_f32_scalar(src + i, dst + i, count - i);
+        }
+
+        // Four pixels per shuffle; the 16 byte load reads one pixel ahead, so the last ones go to the scalar loop
+        PIXELS_TARGET("ssse3")
+        void rgb_to_rgba_u8_ssse3(const u8 *src, u8 *dst, size_t count)
+        {
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+            size_t i = 0;
+            for (; i + 6 <= count; i += 4)
+            {
+                const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+                const __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), rgba);
+            }
+            rgb_to_rgba_u8_scalar(src + i * 3, dst + i * 4, count - i);
+        }
+
+        PIXELS_TARGET("avx2")
+        void rgb_to_rgba_u8_avx2(const u8 *src, u8 *dst, size_t count)
+        {
+            // The shuffle works within 128-bit lanes, so each lane gets its own four pixels
+            const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1,
+                                                     3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+            size_t i = 0;
+            for (; i + 10 <= count; i += 8)
+            {
+                const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+                const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3 + 12));
+                const __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+                const __m256i rgba = _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), rgba);
+            }
+            rgb_to_rgba_u8_scalar(src + i * 3, dst + i * 4, count - i);
+        }
+
+        PIXELS_TARGET("sse2")
+        void rgb_to_rgba_f32_sse2(const f32 *src, f32 *dst, size_t count)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            size_t i = 0;
+            for (; i + 2 <= count; ++i)
+            {
+                // [r g b x] -> [r g b 1], the load reads the first channel of the next pixel
+                const __m128 rgbx = _mm_loadu_ps(src + i * 3);
+                const __m128 b1 = _mm_unpackhi_ps(rgbx, one);
+                _mm_storeu_ps(dst + i * 4, _mm_shuffle_ps(rgbx, b1, _MM_SHUFFLE(1, 0, 1, 0)));
+            }
+            rgb_to_rgba_f32_scalar(src + i * 3, dst + i * 4, count - i);
+        }
+
+        PIXELS_TARGET("avx,f16c")
+        void f32_to_f16_f16c(const f32 *src, u16 *dst, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), half);
+            }
+            f32_to_f16_scalar(src + i, dst + i, count - i);
+        }
+
+        struct CpuFeatures
+        {
+            bool ssse3 = false;
+            bool avx2 = false;
+            bool f16c = false;
+        };
+
+        void cpuid(u32 leaf, u32 regs[4])
+        {
+    #ifdef _MSC_VER
+            int info[4];
+            __cpuidex(info, static_cast<int>(leaf), 0);
+            for (int i = 0; i < 4; ++i) regs[i] = static_cast<u32>(info[i]);
+    #else
+            __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+        }
+
+        CpuFeatures detect_cpu_features()
+        {
+            CpuFeatures features;
+            u32 regs[4];
+            cpuid(0, regs);
+            const u32 max_leaf = regs[0];
+            if (max_leaf < 1) return features;
+            cpuid(1, regs);
+            features.ssse3 = (regs[2] & (1u << 9)) != 0;
+            // AVX state must also be enabled by the OS (OSXSAVE and the XCR0 YMM bits)
+            const bool osxsave = (regs[2] & (1u << 27)) != 0;
+            const bool avx = (regs[2] & (1u << 28)) != 0;
+            bool ymm_enabled = false;
+            if (osxsave)
+            {
+    #ifdef _MSC_VER
+                const u64 xcr0 = _xgetbv(0);
+    #else
+                u32 eax, edx;
+                __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+                const u64 xcr0 = (static_cast<u64>(edx) << 32) | eax;
+    #endif
+                ymm_enabled = (xcr0 & 0x6) == 0x6;
+            }
+            features.f16c = avx && ymm_enabled && (regs[2] & (1u << 29)) != 0;
+            if (max_leaf >= 7 && avx && ymm_enabled)
+            {
+                cpuid(7, regs);
+                features.avx2 = (regs[1] & (1u << 5)) != 0;
+            }
+            return features;
+        }
+#endif
+
+        Kernels select_kernels()
+        {
+            Kernels selected = scalar_kernels();
+#ifdef PIXELS_X86
+            const CpuFeatures features = detect_cpu_features();
+            selected.name = "sse2";
+            selected.u8_to_f32 = u8_to_f32_sse2;
+            selected.rgb_to_rgba_f32 = rgb_to_rgba_f32_sse2;
+            if (features.ssse3)
+            {
+                selected.name = "ssse3";
+                selected.rgb_to_rgba_u8 = rgb_to_rgba_u8_ssse3;
+            }
+            if (features.avx2)
+            {
+                selected.name = "avx2";
+                selected.u8_to_f32 = u8_to_f32_avx2;
+                selected.rgb_to_rgba_u8 = rgb_to_rgba_u8_avx2;
+            }
+            if (features.f16c) selected.f32_to_f16 = f32_to_f16_f16c;
+#endif
+            return selected;
+        }
+
+        // Bytes per channel of the formats the kernels handle, 0 for any other
+        size_t format_size(const umbf::ImageFormat &format)
+        {
+            if (format.type == umbf::ImageFormat::Type::uint && format.bytes_per_channel == 1) return 1;
+            if (format.type == umbf::ImageFormat::Type::sfloat &&
+                (format.bytes_per_channel == 2 || format.bytes_per_channel == 4))
+                return format.bytes_per_channel;
+            return 0;
+        }
+    } // namespace
+
+    const Kernels &scalar_kernels()
+    {
+        static const Kernels kernels{"scalar", u8_to_f32_scalar, rgb_to_rgba_u8_scalar, rgb_to_rgba_f32_scalar,
+                                     f32_to_f16_scalar};
+        return kernels;
+    }
+
+    const Kernels &kernels()
+    {
+        static const Kernels kernels = select_kernels();
+        return kernels;
+    }
+
+    void *convert(const umbf::Image2D &image, const umbf::ImageFormat &format, size_t channels)
+    {
+        const size_t src_channels = image.channels.size();
+        const bool expand = src_channels == 3 && channels == 4;
+        if ((src_channels != 3 && src_channels != 4) || (channels != src_channels && !expand)) return nullptr;
+
+        // Supported: u8 -> u8/f32/f16 and f32 -> f32/f16
+        const size_t src_size = format_size(image.format), dst_size = format_size(format);
+        if (src_size != 1 && src_size != 4) return nullptr;
+        if (dst_size == 0 || (src_size == 4 && dst_size == 1) || (src_size == dst_size && !expand)) return nullptr;
+
+        const Kernels &k = kernels();
+        const size_t width = image.width;
+        const size_t src_row = width * src_channels, dst_row = width * channels;
+        u8 *out = acul::alloc_n<u8>(static_cast<size_t>(image.height) * dst_row * dst_size);
+        acul::vector<u8> bytes;
+        acul::vector<f32> floats;
+        for (size_t y = 0; y < image.height; ++y)
+        {
+            u8 *dst = out + y * dst_row * dst_size;
+            if (src_size == 1)
+            {
+                const u8 *row = static_cast<const u8 *>(image.pixels) + y * src_row;
+                if (expand)
+                {
+                    if (dst_size == 1)
+                    {
+                        k.rgb_to_rgba_u8(row, dst, width);
+                        continue;
+                    }
+                    bytes.resize(dst_row);
+                    k.rgb_to_rgba_u8(row, bytes.data(), width);
+                    row = bytes.data();
+                }
+                if (dst_size == 4)
+                {
+                    k.u8_to_f32(row, reinterpret_cast<f32 *>(dst), dst_row);
+                    continue;
+                }
+                floats.resize(dst_row);
+                k.u8_to_f32(row, floats.data(), dst_row);
+                k.f32_to_f16(floats.data(), reinterpret_cast<u16 *>(dst), dst_row);
+                continue;
+            }
+
+            const f32 *row = static_cast<const f32 *>(image.pixels) + y * src_row;
+            if (expand)
+            {
+                if (dst_size == 4)
+                {
+                    k.rgb_to_rgba_f32(row, reinterpret_cast<f32 *>(dst), width);
+                    continue;
+                }
+                floats.resize(dst_row);
+                k.rgb_to_rgba_f32(row, floats.data(), width);
+                row = floats.data();
+            }
+            k.f32_to_f16(row, reinterpret_cast<u16 *>(dst), dst_row);
+        }
+        return out;
+    }
+} // namespace pixels
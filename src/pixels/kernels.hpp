@@ -0,0 +1,29 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace pixels
+{
+    // Conversion kernels for the common atlas cases. Each has a scalar version and, on x86, SSE/AVX2 versions
+    // that are picked once at runtime by the CPU features. All versions produce identical output.
+    struct Kernels
+    {
+        const char *name;
+        // Normalizes bytes to [0, 1] floats
+        void (*u8_to_f32)(const u8 *src, f32 *dst, size_t count);
+        // Expands RGB to RGBA with an opaque alpha, `count` is the number of pixels
+        void (*rgb_to_rgba_u8)(const u8 *src, u8 *dst, size_t count);
+        void (*rgb_to_rgba_f32)(const f32 *src, f32 *dst, size_t count);
+        // Rounds floats to IEEE half precision (round to nearest even)
+        void (*f32_to_f16)(const f32 *src, u16 *dst, size_t count);
+    };
+
+    const Kernels &scalar_kernels();
+
+    // Fastest kernels supported by the running CPU
+    const Kernels &kernels();
+
+    // Converts the pixels of `image` to `format` with `channels` channels using the kernels above. Returns a new
+    // buffer allocated with acul::alloc_n, or nullptr if the conversion is not one of the supported cases, in
+    // which case callers fall back to umbf::utils::convert_image.
+    void *convert(const umbf::Image2D &image, const umbf::ImageFormat &format, size_t channels);
+} // namespace pixels
@@ -0,0 +1,214 @@
+#include "pack.hpp"
+#include <acul/log.hpp>
+#include <cmath>
+#include "../pipeline.hpp"
+
+namespace pixels
+{
+    bool may_fit(const acul::vector<amal::irect> &rects, i32 padding, i32 side, bool rotate)
+    {
+        i64 area = 0, wide_height = 0, tall_width = 0;
+        for (const auto &rect : rects)
+        {
+            const i64 width = rect.size.x + padding * 2, height = rect.size.y + padding * 2;
+            if (width > side || height > side) return false;
+            area += width * height;
+            if (width * 2 > side) wide_height += height;
+            if (height * 2 > side) tall_width += width;
+        }
+        const i64 side_area = static_cast<i64>(side) * side;
+        if (area > side_area) return false;
+        return rotate || (wide_height <= side && tall_width <= side);
+    }
+
+    acul::vector<PackMode> atlas_pack_modes(bool all_heuristics, bool rotate)
+    {
+        using umbf::utils::MaxRectsHeuristic;
+        constexpr MaxRectsHeuristic heuristics[] = {
+            MaxRectsHeuristic::best_short_side_fit, MaxRectsHeuristic::best_long_side_fit,
+            MaxRectsHeuristic::best_area_fit, MaxRectsHeuristic::bottom_left_rule,
+            MaxRectsHeuristic::contact_point_rule};
+        acul::vector<PackMode> modes;
+        for (auto heuristic : heuristics)
+        {
+            if (!all_heuristics && heuristic != MaxRectsHeuristic::best_short_side_fit) continue;
+            modes.push_back({heuristic, umbf::utils::MaxRectsTransformBits::none});
+            if (rotate) modes.push_back({heuristic, umbf::utils::MaxRectsTransformBits::rotate_90});
+        }
+        return modes;
+    }
+
+    bool pack_atlas(const acul::vector<amal::irect> &rects, i32 padding, i32 side, const PackMode &mode,
+                    acul::vector<amal::irect> &out)
+    {
+        const bool rotate = mode.transform == umbf::utils::MaxRectsTransformBits::rotate_90;
+        if (!may_fit(rects, padding, side, rotate)) return false;
+        out.assign(rects.begin(), rects.end());
+        return umbf::utils::pack_max_rects({side, side}, 0, out, mode.heuristic, mode.transform, padding).packed;
+    }
+
+    AtlasLayout find_min_square_atlas_size(const acul::vector<amal::irect> &rects, i32 padding, u32 jobs,
+                                           const PackMode &mode)
+    {
+        AtlasLayout layout;
+        if (rects.empty()) return layout;
+
+        constexpr size_t probes_per_round = 4;
+        i64 area = 0;
+        i32 lower = 1;
+        for (const auto &rect : rects)
+        {
+            const i64 width = rect.size.x + padding * 2, height = rect.size.y + padding * 2;
+            area += width * height;
+            lower = amal::max(lower, static_cast<i32>(amal::max(width, height)));
+        }
+        i32 side = static_cast<i32>(std::sqrt(static_cast<f64>(area)));
+        while (static_cast<i64>(side) * side < area) ++side;
+        lower = amal::max(lower, side);
+
+        if (pack_atlas(rects, padding, lower, mode, layout.rects))
+        {
+            layout.size = {lower, lower};
+            return layout;
+        }
+
+        acul::vector<amal::irect> buffers[probes_per_round];
+        i32 fail = lower, pass = 0;
+        // Probes the given sides, ascending, and narrows (fail, pass) to the smallest fitting side found
+        auto run_round = [&](const acul::vector<i32> &sides) {
+            acul::vector<char> packed(sides.size(), 0);
+            run_ordered<char>(
+                sides.size(), std::min<u32>(jobs, static_cast<u32>(sides.size())),
+                [&](size_t i) { return static_cast<char>(pack_atlas(rects, padding, sides[i], mode, buffers[i])); },
+                [&](size_t i, char &result) {
+                    packed[i] = result;
+                    return true;
+                });
+            for (size_t i = 0; i < sides.size(); ++i)
+            {
+                if (!packed[i])
+                {
+                    fail = amal::max(fail, sides[i]);
+                    continue;
+                }
+                pass = sides[i];
+                std::swap(layout.rects, buffers[i]);
+                return;
+            }
+        };
+
+        i32 step = amal::max(1, lower / 8);
+        acul::vector<i32> sides;
+        while (pass == 0)
+        {
+            if (fail > (1 << 29) || step > (1 << 26)) throw acul::runtime_error("Failed to determine atlas size");
+            sides.clear();
+            for (size_t i = 1; i <= probes_per_round; ++i) sides.push_back(fail + step * static_cast<i32>(i));
+            run_round(sides);
+            step *= 2;
+        }
+        while (pass - fail > 1)
+        {
+            const i32 gap = pass - fail;
+            sides.clear();
+            for (size_t i = 1; i <= probes_per_round; ++i)
+            {
+                const i32 candidate = fail + static_cast<i32>(static_cast<i64>(gap) * i / (probes_per_round + 1));
+                if (candidate > fail && candidate < pass && (sides.empty() || candidate > sides.back()))
+                    sides.push_back(candidate);
+            }
+            run_round(sides);
+        }
+        layout.size = {pass, pass};
+        return layout;
+    }
+
+    AtlasLayout find_best_atlas_layout(const acul::vector<amal::irect> &rects, i32 padding, u32 jobs,
+                                       const acul::vector<PackMode> &modes)
+    {
+        if (modes.size() == 1) return find_min_square_atlas_size(rects, padding, jobs, modes.front());
+        acul::vector<AtlasLayout> layouts(modes.size());
+        acul::vector<char> found(modes.size(), 0);
+        parallel_for(modes.size(), jobs, [&](size_t i) {
+            try
+            {
+                layouts[i] = find_min_square_atlas_size(rects, padding, 1, modes[i]);
+                found[i] = 1;
+            }
+            catch (const acul::runtime_error &)
+            {
+                // Another mode may still succeed
+            }
+        });
+        size_t best = modes.size();
+        for (size_t i = 0; i < modes.size(); ++i)
+        {
+            if (!found[i]) continue;
+            const i64 area = static_cast<i64>(layouts[i].size.x) * layouts[i].size.y;
+            if (best == modes.size() || area < static_cast<i64>(layouts[best].size.x) * layouts[best].size.y)
+                best = i;
+        }
+        if (best == modes.size()) throw acul::runtime_error("Failed to determine atlas size");
+        return std::move(layouts[best]);
+    }
+
+    bool pack_atlas(const acul::vector<amal::irect> &rects, i32 padding, i32 side, const acul::vector<PackMode> &modes,
+                    acul::vector<amal::irect> &out)
+    {
+        for (const auto &mode : modes)
+            if (pack_atlas(rects, padding, side, mode, out)) return true;
+        return false;
+    }
+
+    bool pack_atlas_pages(const acul::vector<amal::irect> &rects, i32 padding, i32 max_side, u32 jobs,
+                          const acul::vector<PackMode> &modes, acul::vector<AtlasPage> &pages)
+    {
+        acul::vector<size_t> order(rects.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return amal::max(rects[a].size.x, rects[a].size.y) > amal::max(rects[b].size.x, rects[b].size.y);
+        });
+
+        acul::vector<amal::irect> run, packed, best;
+        auto collect = [&](size_t first, size_t count) {
+            run.clear();
+            for (size_t i = first; i < first + count; ++i) run.push_back(rects[order[i]]);
+        };
+        for (size_t first = 0; first < order.size();)
+        {
+            collect(first, 1);
+            if (!pack_atlas(run, padding, max_side, modes, best))
+            {
+                LOG_ERROR("Image does not fit in an atlas page of %d pixels: %dx%d", max_side,
+                          rects[order[first]].size.x, rects[order[first]].size.y);
+                return false;
+            }
+            size_t fit = 1, fail = order.size() - first + 1;
+            while (fail - fit > 1)
+            {
+                const size_t count = fit + (fail - fit) / 2;
+                collect(first, count);
+                if (pack_atlas(run, padding, max_side, modes, packed))
+                {
+                    fit = count;
+                    std::swap(best, packed);
+                }
+                else fail = count;
+            }
+
+            AtlasPage page;
+            page.indices.assign(order.begin() + first, order.begin() + first + fit);
+            collect(first, fit);
+            page.layout = find_best_atlas_layout(run, padding, jobs, modes);
+            if (page.layout.size.x > max_side)
+            {
+                // Packing is not monotonic in the side, so the search may stop above the size bisection packed at
+                page.layout.size = {max_side, max_side};
+                page.layout.rects = std::move(best);
+            }
+            pages.push_back(std::move(page));
+            first += fit;
+        }
+        return true;
+    }
+} // namespace pixels
@@ -0,0 +1,61 @@
+#pragma once
+#include <umbf/utils.hpp>
+
+namespace pixels
+{
+    struct AtlasLayout
+    {
+        amal::ivec2 size{1, 1};
+        acul::vector<amal::irect> rects; // Packed at `size`, in the order of the input
+    };
+
+    struct PackMode
+    {
+        umbf::utils::MaxRectsHeuristic heuristic = umbf::utils::MaxRectsHeuristic::best_short_side_fit;
+        umbf::utils::MaxRectsTransformBits transform = umbf::utils::MaxRectsTransformBits::none;
+    };
+
+    // The modes tried by an atlas build: the default heuristic, or all of them, each with and without rotation
+    // when `rotate` is set. The default mode comes first, so it wins ties and a search over all modes never does
+    // worse than the default.
+    acul::vector<PackMode> atlas_pack_modes(bool all_heuristics, bool rotate);
+
+    // Necessary conditions a side must meet for the rects to fit, checked before paying for a packing. Rects
+    // wider than half the side can never stand next to each other, so their heights must add up within the side;
+    // the same holds for tall rects and their widths. With `rotate` a wide rect may be turned into a tall one, so
+    // only the area and the size of every rect are checked.
+    bool may_fit(const acul::vector<amal::irect> &rects, i32 padding, i32 side, bool rotate);
+
+    // Packs the rects into a square of `side`, in the order of the input, or returns false if they do not fit
+    bool pack_atlas(const acul::vector<amal::irect> &rects, i32 padding, i32 side, const PackMode &mode,
+                    acul::vector<amal::irect> &out);
+
+    // A set of rects fits a page if any of the modes packs it
+    bool pack_atlas(const acul::vector<amal::irect> &rects, i32 padding, i32 side, const acul::vector<PackMode> &modes,
+                    acul::vector<amal::irect> &out);
+
+    // Finds the smallest square side the rects pack into and returns that packing, so it is not redone.
+    // The search starts at the area lower bound, which is often already a fit. Otherwise every round packs a
+    // fixed number of candidate sides concurrently, first growing past the bound and then narrowing the gap
+    // between the largest failing and the smallest fitting side. The candidates do not depend on `jobs`, so
+    // neither does the result. Throws acul::runtime_error if no size is found.
+    AtlasLayout find_min_square_atlas_size(const acul::vector<amal::irect> &rects, i32 padding, u32 jobs,
+                                           const PackMode &mode);
+
+    // Runs the size search for every mode, one per thread, and keeps the smallest atlas. Ties go to the earlier
+    // mode, so the result does not depend on `jobs`.
+    AtlasLayout find_best_atlas_layout(const acul::vector<amal::irect> &rects, i32 padding, u32 jobs,
+                                       const acul::vector<PackMode> &modes);
+
+    struct AtlasPage
+    {
+        AtlasLayout layout;
+        acul::vector<size_t> indices; // Input rect of each of layout.rects
+    };
+
+    // Distributes the rects over square pages of at most `max_side`. Rects are taken biggest first, and every
+    // page gets the longest run of the remaining ones that still packs at `max_side` (found by bisection), before
+    // it is shrunk to its minimal square. Returns false if a rect alone does not fit in a page.
+    bool pack_atlas_pages(const acul::vector<amal::irect> &rects, i32 padding, i32 max_side, u32 jobs,
+                          const acul::vector<PackMode> &modes, acul::vector<AtlasPage> &pages);
+} // namespace pixels
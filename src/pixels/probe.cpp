@@ -0,0 +1,139 @@
+#include "probe.hpp"
+#include <acul/io/fs/path.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace pixels
+{
+    namespace
+    {
+        u32 read_be16(const u8 *p) { return (p[0] << 8) | p[1]; }
+        u32 read_be32(const u8 *p) { return (u32(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+        u32 read_le16(const u8 *p) { return p[0] | (p[1] << 8); }
+        u32 read_le32(const u8 *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (u32(p[3]) << 24); }
+
+        class Reader
+        {
+        public:
+            explicit Reader(const acul::string &path) : _file(fopen(path.c_str(), "rb")) {}
+            ~Reader()
+            {
+                if (_file) fclose(_file);
+            }
+
+            Reader(const Reader &) = delete;
+            Reader &operator=(const Reader &) = delete;
+
+            bool is_open() const { return _file != nullptr; }
+            bool read(void *data, size_t size) { return fread(data, 1, size, _file) == size; }
+            bool skip(long size) { return fseek(_file, size, SEEK_CUR) == 0; }
+            bool seek(long offset) { return fseek(_file, offset, SEEK_SET) == 0; }
+            bool read_line(char *line, int size) { return fgets(line, size, _file) != nullptr; }
+
+        private:
+            FILE *_file;
+        };
+
+        // Walks the marker segments up to the first start-of-frame
+        bool probe_jpeg(Reader &reader, u32 &width, u32 &height)
+        {
+            if (!reader.seek(2)) return false;
+            u8 marker[2];
+            while (reader.read(marker, 2))
+            {
+                if (marker[0] != 0xFF) return false;
+                const u8 type = marker[1];
+                if (type == 0xFF)
+                {
+                    // Fill byte, the second one may start the actual marker
+                    if (!reader.skip(-1)) return false;
+                    continue;
+                }
+                if (type == 0xD8 || (type >= 0xD0 && type <= 0xD7) || type == 0x01) continue;
+                u8 length_bytes[2];
+                if (!reader.read(length_bytes, 2)) return false;
+                const u32 length = read_be16(length_bytes);
+                if (length < 2) return false;
+                const bool start_of_frame =
+                    type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC;
+                if (start_of_frame)
+                {
+                    u8 frame[5];
+                    if (!reader.read(frame, 5)) return false;
+                    height = read_be16(frame + 1);
+                    width = read_be16(frame + 3);
+                    return width > 0 && height > 0;
+                }
+                if (!reader.skip(static_cast<long>(length) - 2)) return false;
+            }
+            return false;
+        }
+
+        // The resolution line follows the header, which ends with an empty line
+        bool probe_hdr(Reader &reader, u32 &width, u32 &height)
+        {
+            if (!reader.seek(0)) return false;
+            char line[256];
+            bool header_done = false;
+            while (reader.read_line(line, sizeof(line)))
+            {
+                if (!header_done)
+                {
+                    header_done = line[0] == '\n' || (line[0] == '\r' && line[1] == '\n');
+                    continue;
+                }
+                char y_axis[3], x_axis[3];
+                unsigned long rows, columns;
+                if (sscanf(line, "%2s %lu %2s %lu", y_axis, &rows, x_axis, &columns) != 4) return false;
+                // Either axis may come first; the second number is always along the second axis
+                const bool rows_first = y_axis[1] == 'Y';
+                height = static_cast<u32>(rows_first ? rows : columns);
+                width = static_cast<u32>(rows_first ? columns : rows);
+                return width > 0 && height > 0;
+            }
+            return false;
+        }
+    } // namespace
+
+    bool probe_size(const acul::string &path, u32 &width, u32 &height)
+    {
+        Reader reader(path);
+        if (!reader.is_open()) return false;
+        u8 header[32] = {};
+        if (!reader.read(header, 18)) return false;
+        reader.read(header + 18, sizeof(header) - 18);
+
+        static const u8 png_signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        if (memcmp(header, png_signature, sizeof(png_signature)) == 0)
+        {
+            width = read_be32(header + 16);
+            height = read_be32(header + 20);
+            return width > 0 && height > 0;
+        }
+        if (header[0] == 0xFF && header[1] == 0xD8) return probe_jpeg(reader, width, height);
+        if (memcmp(header, "GIF87a", 6) == 0 || memcmp(header, "GIF89a", 6) == 0)
+        {
+            width = read_le16(header + 6);
+            height = read_le16(header + 8);
+            return width > 0 && height > 0;
+        }
+        if (header[0] == 'B' && header[1] == 'M')
+        {
+            // Negative heights mark top-down bitmaps
+            width = read_le32(header + 18);
+            height = static_cast<u32>(std::abs(static_cast<i32>(read_le32(header + 22))));
+            return width > 0 && height > 0;
+        }
+        if (memcmp(header, "#?RADIANCE", 10) == 0 || memcmp(header, "#?RGBE", 6) == 0)
+            return probe_hdr(reader, width, height);
+        // TGA has no signature
+        if (acul::fs::get_extension(path) == ".tga")
+        {
+            width = read_le16(header + 12);
+            height = read_le16(header + 14);
+            return width > 0 && height > 0;
+        }
+        return false;
+    }
+} // namespace pixels
@@ -0,0 +1,9 @@
+#pragma once
+#include <acul/string/string.hpp>
+
+namespace pixels
+{
+    // Reads the dimensions of an image from its header without decoding it. Understands PNG, JPEG, BMP, GIF,
+    // TGA and Radiance HDR; returns false for anything else so callers can fall back to a full decode.
+    bool probe_size(const acul::string &path, u32 &width, u32 &height);
+} // namespace pixels
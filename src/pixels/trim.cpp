@@ -0,0 +1,149 @@
+#include "trim.hpp"
+#include <cstring>
+#include <unordered_map>
+#include "../hash.hpp"
+#include "../pipeline.hpp"
+#include "../raw/aux.hpp"
+
+namespace pixels
+{
+    namespace
+    {
+        constexpr u32 sprite_table_version = 2;
+
+        struct Bounds
+        {
+            u32 x = 0, y = 0, width = 1, height = 1;
+        };
+
+        Bounds opaque_bounds(const umbf::Image2D &image, size_t alpha)
+        {
+            const size_t channel_size = image.format.bytes_per_channel;
+            const size_t pixel_size = image.channels.size() * channel_size;
+            const u8 *pixels = static_cast<const u8 *>(image.pixels);
+            auto opaque = [&](size_t x, size_t y) {
+                const u8 *value = pixels + (y * image.width + x) * pixel_size + alpha * channel_size;
+                for (size_t i = 0; i < channel_size; ++i)
+                    if (value[i]) return true;
+                return false;
+            };
+            u32 left = image.width, right = 0, top = image.height, bottom = 0;
+            for (u32 y = 0; y < image.height; ++y)
+                for (u32 x = 0; x < image.width; ++x)
+                {
+                    if (!opaque(x, y)) continue;
+                    left = std::min(left, x);
+                    right = std::max(right, x);
+                    top = std::min(top, y);
+                    bottom = std::max(bottom, y);
+                }
+            if (left > right) return {};
+            return {left, top, right - left + 1, bottom - top + 1};
+        }
+
+        acul::shared_ptr<umbf::Image2D> crop(const umbf::Image2D &image, const Bounds &bounds)
+        {
+            auto cropped = acul::make_shared<umbf::Image2D>(image);
+            cropped->width = bounds.width;
+            cropped->height = bounds.height;
+            const size_t pixel_size = image.channels.size() * image.format.bytes_per_channel;
+            const size_t row_size = bounds.width * pixel_size;
+            const u8 *source = static_cast<const u8 *>(image.pixels);
+            u8 *pixels = acul::alloc_n<u8>(row_size * bounds.height);
+            for (size_t y = 0; y < bounds.height; ++y)
+                memcpy(pixels + y * row_size,
+                       source + ((bounds.y + y) * image.width + bounds.x) * pixel_size, row_size);
+            cropped->pixels = pixels;
+            return cropped;
+        }
+
+        bool same_pixels(const umbf::Image2D &a, const umbf::Image2D &b)
+        {
+            if (a.width != b.width || a.height != b.height || a.channels.size() != b.channels.size() ||
+                a.format != b.format)
+                return false;
+            const size_t size =
+                static_cast<size_t>(a.width) * a.height * a.channels.size() * a.format.bytes_per_channel;
+            return memcmp(a.pixels, b.pixels, size) == 0;
+        }
+    } // namespace
+
+    acul::shared_ptr<umbf::RawBlock> write_sprite_table(const SpriteTable &table)
+    {
+        raw::ByteWriter writer;
+        writer.write(sprite_table_version);
+        writer.write(static_cast<u64>(table.sprites.size()));
+        for (const auto &sprite : table.sprites)
+        {
+            writer.write(sprite.source_width);
+            writer.write(sprite.source_height);
+            writer.write(sprite.x);
+            writer.write(sprite.y);
+            writer.write(sprite.alias);
+            writer.write(sprite.flags);
+        }
+        return raw::make_aux_block(raw::aux_tag::atlas_sprites, writer.data());
+    }
+
+    bool read_sprite_table(const umbf::File &file, SpriteTable &table)
+    {
+        raw::ByteReader reader;
+        if (!raw::find_aux_block(file, raw::aux_tag::atlas_sprites, reader)) return false;
+        u32 version;
+        u64 count;
+        if (!reader.read(version) || version != sprite_table_version || !reader.read(count)) return false;
+        if (count > reader.remaining() / (sizeof(u32) * 6)) return false;
+        table.sprites.resize(count);
+        for (auto &sprite : table.sprites)
+            if (!reader.read(sprite.source_width) || !reader.read(sprite.source_height) || !reader.read(sprite.x) ||
+                !reader.read(sprite.y) || !reader.read(sprite.alias) || !reader.read(sprite.flags))
+                return false;
+        return true;
+    }
+
+    acul::vector<acul::shared_ptr<umbf::Image2D>> trim_sprites(acul::vector<acul::shared_ptr<umbf::Image2D>> &sprites,
+                                                               SpriteTable &table, u32 jobs)
+    {
+        table.sprites.assign(sprites.size(), {});
+        acul::vector<acul::shared_ptr<umbf::Image2D>> cropped(sprites.size());
+        acul::vector<u64> hashes(sprites.size());
+        parallel_for(sprites.size(), jobs, [&](size_t i) {
+            const auto &sprite = *sprites[i];
+            auto &trim = table.sprites[i];
+            trim.source_width = sprite.width;
+            trim.source_height = sprite.height;
+            trim.alias = static_cast<u32>(i);
+            const auto alpha = std::find(sprite.channels.begin(), sprite.channels.end(), "A");
+            if (alpha != sprite.channels.end())
+            {
+                const Bounds bounds = opaque_bounds(sprite, alpha - sprite.channels.begin());
+                trim.x = bounds.x;
+                trim.y = bounds.y;
+                if (bounds.width != sprite.width || bounds.height != sprite.height) cropped[i] = crop(sprite, bounds);
+            }
+            const auto &trimmed = cropped[i] ? *cropped[i] : sprite;
+            hashes[i] = hash_bytes(trimmed.pixels, static_cast<size_t>(trimmed.width) * trimmed.height *
+                                                       trimmed.channels.size() * trimmed.format.bytes_per_channel);
+        });
+
+        acul::vector<acul::shared_ptr<umbf::Image2D>> owned;
+        std::unordered_map<u64, acul::vector<size_t>> seen;
+        for (size_t i = 0; i < sprites.size(); ++i)
+        {
+            if (cropped[i])
+            {
+                sprites[i] = cropped[i];
+                owned.push_back(cropped[i]);
+            }
+            auto &candidates = seen[hashes[i]];
+            for (size_t candidate : candidates)
+            {
+                if (!same_pixels(*sprites[candidate], *sprites[i])) continue;
+                table.sprites[i].alias = static_cast<u32>(candidate);
+                break;
+            }
+            if (table.sprites[i].alias == i) candidates.push_back(i);
+        }
+        return owned;
+    }
+} // namespace pixels
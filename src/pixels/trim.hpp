@@ -0,0 +1,36 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace pixels
+{
+    // The packed rect of the sprite holds it rotated 90 degrees clockwise
+    constexpr u32 sprite_rotated = 0x1;
+
+    // Placement of every sprite of a trimmed or rotating atlas inside its source image, indexed like pack_data.
+    // The packed rect of a sprite only covers its opaque part, which starts at (x, y) of the source_width x
+    // source_height source. Sprites with the same trimmed pixels as an earlier one name it in `alias` and share its
+    // rect; for all others `alias` is their own index. Stored in an auxiliary block after the atlas pages.
+    struct SpriteTrim
+    {
+        u32 source_width = 0, source_height = 0;
+        u32 x = 0, y = 0;
+        u32 alias = 0;
+        u32 flags = 0; // sprite_rotated
+    };
+
+    struct SpriteTable
+    {
+        acul::vector<SpriteTrim> sprites;
+    };
+
+    acul::shared_ptr<umbf::RawBlock> write_sprite_table(const SpriteTable &table);
+
+    bool read_sprite_table(const umbf::File &file, SpriteTable &table);
+
+    // Crops the fully transparent border of every sprite on `jobs` threads and detects sprites whose remaining
+    // pixels are identical. Cropped sprites replace their entries in `sprites` and are returned, the caller owns
+    // their pixels. Aliases are left in `sprites` untouched; only the table says they need no rect of their own.
+    // A sprite without any opaque pixel keeps its top-left pixel, images without an "A" channel are not trimmed.
+    acul::vector<acul::shared_ptr<umbf::Image2D>> trim_sprites(acul::vector<acul::shared_ptr<umbf::Image2D>> &sprites,
+                                                               SpriteTable &table, u32 jobs);
+} // namespace pixels
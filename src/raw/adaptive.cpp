@@ -0,0 +1,55 @@
+#include "adaptive.hpp"
+#include <acul/io/fs/file.hpp>
+#include <cmath>
+
+namespace raw
+{
+    namespace
+    {
+        constexpr size_t sample_count = 16;
+        constexpr size_t sample_size = 4096;
+        constexpr size_t trial_size = 64 * 1024;
+        constexpr size_t min_trial_input = 4096; // Smaller inputs are cheaper to just compress
+        constexpr f32 max_entropy = 7.95f;
+    } // namespace
+
+    f32 sample_entropy(const char *data, size_t size)
+    {
+        if (size == 0) return 0.0f;
+        u64 histogram[256] = {};
+        u64 total = 0;
+        auto count = [&](const char *begin, size_t length) {
+            for (size_t i = 0; i < length; ++i) ++histogram[static_cast<u8>(begin[i])];
+            total += length;
+        };
+
+        if (size <= sample_count * sample_size) count(data, size);
+        else
+        {
+            const size_t stride = (size - sample_size) / (sample_count - 1);
+            for (size_t i = 0; i < sample_count; ++i) count(data + i * stride, sample_size);
+        }
+
+        f64 entropy = 0.0;
+        for (u64 value : histogram)
+        {
+            if (value == 0) continue;
+            const f64 p = static_cast<f64>(value) / static_cast<f64>(total);
+            entropy -= p * std::log2(p);
+        }
+        return static_cast<f32>(entropy);
+    }
+
+    bool worth_compressing(const char *data, size_t size, f32 min_ratio, int level)
+    {
+        if (size < min_trial_input) return true;
+        if (sample_entropy(data, size) > max_entropy) return false;
+        if (size <= trial_size * 2) return true;
+
+        // Trial on a window from the middle, which is less likely than the head to be a header or an index
+        const char *trial = data + (size - trial_size) / 2;
+        acul::vector<char> compressed;
+        if (!acul::fs::compress(trial, trial_size, compressed, level).success()) return true;
+        return static_cast<f32>(compressed.size()) <= static_cast<f32>(trial_size) * min_ratio;
+    }
+} // namespace raw
@@ -0,0 +1,13 @@
+#pragma once
+#include <acul/string/string.hpp>
+
+namespace raw
+{
+    // Shannon entropy in bits per byte, estimated from evenly spaced samples of the data
+    f32 sample_entropy(const char *data, size_t size);
+
+    // Cheap pre-check for adaptive compression: rejects data that is near-random (already compressed media,
+    // archives) by entropy and then by compressing a small sample. A positive answer still has to be confirmed
+    // by the ratio of the real compression.
+    bool worth_compressing(const char *data, size_t size, f32 min_ratio, int level);
+} // namespace raw
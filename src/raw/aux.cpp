@@ -0,0 +1,70 @@
+#include "aux.hpp"
+
+namespace raw
+{
+    namespace
+    {
+        constexpr char aux_signature[8] = {'U', 'M', 'B', 'F', 'C', 'A', 'U', 'X'};
+        constexpr size_t aux_header_size = sizeof(aux_signature) + sizeof(u32);
+
+        bool read_aux_header(const umbf::Block &block, u32 tag, ByteReader &reader)
+        {
+            if (block.signature() != umbf::sign_block::raw) return false;
+            const auto &raw_block = static_cast<const umbf::RawBlock &>(block);
+            if (raw_block.data_size < aux_header_size) return false;
+            if (memcmp(raw_block.data, aux_signature, sizeof(aux_signature)) != 0) return false;
+            u32 block_tag;
+            memcpy(&block_tag, raw_block.data + sizeof(aux_signature), sizeof(block_tag));
+            if (block_tag != tag) return false;
+            reader = ByteReader(raw_block.data + aux_header_size, raw_block.data_size - aux_header_size);
+            return true;
+        }
+    } // namespace
+
+    acul::shared_ptr<umbf::RawBlock> make_aux_block(u32 tag, const acul::vector<char> &body)
+    {
+        auto block = acul::make_shared<umbf::RawBlock>();
+        block->data_size = aux_header_size + body.size();
+        block->data = acul::alloc_n<char>(block->data_size);
+        memcpy(block->data, aux_signature, sizeof(aux_signature));
+        memcpy(block->data + sizeof(aux_signature), &tag, sizeof(tag));
+        if (!body.empty()) memcpy(block->data + aux_header_size, body.data(), body.size());
+        return block;
+    }
+
+    void append_aux_blocks(acul::vector<acul::shared_ptr<umbf::Block>> &blocks,
+                           const acul::vector<acul::shared_ptr<umbf::RawBlock>> &aux)
+    {
+        if (aux.empty()) return;
+        blocks.insert(blocks.end(), aux.begin(), aux.end());
+        ByteWriter writer;
+        writer.write(static_cast<u32>(aux.size()));
+        blocks.push_back(make_aux_block(aux_tag::trailer, writer.data()));
+    }
+
+    bool find_aux_block(const umbf::File &file, u32 tag, ByteReader &reader)
+    {
+        return find_aux_block(file.blocks, tag, reader);
+    }
+
+    size_t count_aux_blocks(const acul::vector<acul::shared_ptr<umbf::Block>> &blocks)
+    {
+        // Without a trailer the list has no aux blocks, and a payload that merely looks like one is never counted
+        if (blocks.empty()) return 0;
+        ByteReader trailer;
+        u32 count;
+        if (!read_aux_header(*blocks.back(), aux_tag::trailer, trailer) || trailer.remaining() != sizeof(count) ||
+            !trailer.read(count) || count > blocks.size() - 1)
+            return 0;
+        return static_cast<size_t>(count) + 1;
+    }
+
+    bool find_aux_block(const acul::vector<acul::shared_ptr<umbf::Block>> &blocks, u32 tag, ByteReader &reader)
+    {
+        const size_t count = count_aux_blocks(blocks);
+        if (count == 0) return false;
+        for (size_t i = blocks.size() - count; i < blocks.size() - 1; ++i)
+            if (read_aux_header(*blocks[i], tag, reader)) return true;
+        return false;
+    }
+} // namespace raw
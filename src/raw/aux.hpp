@@ -0,0 +1,104 @@
+#pragma once
+#include <cstring>
+#include <umbf/umbf.hpp>
+
+namespace raw
+{
+    // Auxiliary data of a raw asset (build manifest, compression tables, ...) is kept in extra RawBlocks appended
+    // after the regular blocks of the file. Each one starts with a fixed signature and a tag naming its contents,
+    // so readers that do not know a tag simply skip the block. A trailer block closes the list with the number of
+    // aux blocks before it; only those are aux blocks, so payload bytes that happen to start with the signature are
+    // never taken for one.
+    namespace aux_tag
+    {
+        constexpr u32 manifest = 0x4E414D55;      // 'UMAN'
+        constexpr u32 entry_flags = 0x4C464555;   // 'UEFL', no body: per-entry header flags are authoritative
+        constexpr u32 chunk_table = 0x4B484355;   // 'UCHK', see chunked.hpp
+        constexpr u32 dictionary = 0x54434455;    // 'UDCT', see dictionary.hpp
+        constexpr u32 atlas_pages = 0x47504155;   // 'UAPG', see pixels/atlas.hpp
+        constexpr u32 atlas_sprites = 0x50534155; // 'UASP', see pixels/trim.hpp
+        constexpr u32 mesh_vertices = 0x56514D55; // 'UMQV', see mesh/quantize.hpp
+        constexpr u32 trailer = 0x54584155;       // 'UAXT', u32 count of the aux blocks preceding it
+    } // namespace aux_tag
+
+    class ByteWriter
+    {
+    public:
+        template <typename T>
+        void write(const T &value)
+        {
+            write(&value, sizeof(T));
+        }
+
+        void write(const acul::string &value)
+        {
+            write(static_cast<u32>(value.size()));
+            write(value.c_str(), value.size());
+        }
+
+        void write(const void *data, size_t size)
+        {
+            const char *bytes = static_cast<const char *>(data);
+            _data.insert(_data.end(), bytes, bytes + size);
+        }
+
+        const acul::vector<char> &data() const { return _data; }
+
+    private:
+        acul::vector<char> _data;
+    };
+
+    class ByteReader
+    {
+    public:
+        ByteReader() = default;
+        ByteReader(const char *data, size_t size) : _data(data), _size(size) {}
+
+        template <typename T>
+        bool read(T &value)
+        {
+            return read(&value, sizeof(T));
+        }
+
+        bool read(acul::string &value)
+        {
+            u32 length;
+            if (!read(length) || _size - _pos < length) return false;
+            value = acul::string(_data + _pos, length);
+            _pos += length;
+            return true;
+        }
+
+        bool read(void *data, size_t size)
+        {
+            if (_size - _pos < size) return false;
+            memcpy(data, _data + _pos, size);
+            _pos += size;
+            return true;
+        }
+
+        const char *data() const { return _data + _pos; }
+        size_t remaining() const { return _size - _pos; }
+
+    private:
+        const char *_data = nullptr;
+        size_t _size = 0;
+        size_t _pos = 0;
+    };
+
+    acul::shared_ptr<umbf::RawBlock> make_aux_block(u32 tag, const acul::vector<char> &body);
+
+    // Appends the aux blocks of a file or any other block list, followed by their trailer. Called once per list,
+    // after all regular blocks.
+    void append_aux_blocks(acul::vector<acul::shared_ptr<umbf::Block>> &blocks,
+                           const acul::vector<acul::shared_ptr<umbf::RawBlock>> &aux);
+
+    // Number of aux blocks at the end of the list, trailer included, or 0 if the list has none
+    size_t count_aux_blocks(const acul::vector<acul::shared_ptr<umbf::Block>> &blocks);
+
+    // Looks the tagged block up among the aux blocks of the file and positions the reader at its body
+    bool find_aux_block(const umbf::File &file, u32 tag, ByteReader &reader);
+
+    // The same for any block list, e.g. the meta blocks of a scene object
+    bool find_aux_block(const acul::vector<acul::shared_ptr<umbf::Block>> &blocks, u32 tag, ByteReader &reader);
+} // namespace raw
@@ -0,0 +1,34 @@
+#include "borrow.hpp"
+#include <cstring>
+
+namespace raw
+{
+    BorrowedBlocks::~BorrowedBlocks()
+    {
+        for (auto &entry : _entries)
+        {
+            // The block may still be referenced by a file; leave it empty instead of pointing at the mapping
+            entry.block->data = acul::alloc_n<char>(0);
+            entry.block->data_size = 0;
+        }
+    }
+
+    acul::shared_ptr<umbf::RawBlock> BorrowedBlocks::borrow(io::MappedFile &&source)
+    {
+        auto block = acul::make_shared<umbf::RawBlock>();
+        block->data_size = source.size();
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if (source.size() > 0 && _entries.size() < max_mappings)
+            {
+                block->data = const_cast<char *>(source.data());
+                _entries.push_back({std::move(source), block});
+                return block;
+            }
+        }
+        block->data = acul::alloc_n<char>(source.size());
+        if (source.size() > 0) memcpy(block->data, source.data(), source.size());
+        source.close();
+        return block;
+    }
+} // namespace raw
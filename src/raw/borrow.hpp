@@ -0,0 +1,38 @@
+#pragma once
+#include <mutex>
+#include <umbf/umbf.hpp>
+#include "../io/mapped_file.hpp"
+
+namespace raw
+{
+    // RawBlocks that point straight at a mapped source file instead of a heap copy of it, so the source bytes are
+    // read once, by the save, and never held twice. The mappings are owned here; like a spilled payload, the blocks
+    // are detached (left empty) before their mapping goes away, so this must outlive saving every file that holds
+    // one of them.
+    // Beyond max_mappings sources are copied after all, which keeps huge trees within the per-process limit on
+    // mappings.
+    class BorrowedBlocks
+    {
+    public:
+        static constexpr size_t max_mappings = 16384;
+
+        BorrowedBlocks() = default;
+        ~BorrowedBlocks();
+
+        BorrowedBlocks(const BorrowedBlocks &) = delete;
+        BorrowedBlocks &operator=(const BorrowedBlocks &) = delete;
+
+        // Takes the mapping over and returns a block of its bytes. Thread-safe.
+        acul::shared_ptr<umbf::RawBlock> borrow(io::MappedFile &&source);
+
+    private:
+        struct Entry
+        {
+            io::MappedFile source;
+            acul::shared_ptr<umbf::RawBlock> block;
+        };
+
+        std::mutex _lock;
+        acul::vector<Entry> _entries;
+    };
+} // namespace raw
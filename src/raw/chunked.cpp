@@ -0,0 +1,84 @@
+#include "chunked.hpp"
+#include <acul/io/fs/file.hpp>
+#include <acul/log.hpp>
+#include "../pipeline.hpp"
+#include "aux.hpp"
+
+namespace raw
+{
+    namespace
+    {
+        constexpr u32 chunk_table_version = 1;
+    }
+
+    acul::shared_ptr<umbf::RawBlock> write_chunk_table(const ChunkTable &table)
+    {
+        ByteWriter writer;
+        writer.write(chunk_table_version);
+        writer.write(table.raw_size);
+        writer.write(table.chunk_size);
+        writer.write(static_cast<u64>(table.count()));
+        for (u64 offset : table.offsets) writer.write(offset);
+        return make_aux_block(aux_tag::chunk_table, writer.data());
+    }
+
+    bool read_chunk_table(const umbf::File &file, ChunkTable &table)
+    {
+        ByteReader reader;
+        if (!find_aux_block(file, aux_tag::chunk_table, reader)) return false;
+        u32 version;
+        u64 count;
+        if (!reader.read(version) || version != chunk_table_version) return false;
+        if (!reader.read(table.raw_size) || !reader.read(table.chunk_size) || !reader.read(count)) return false;
+        if (table.chunk_size == 0 || count + 1 > reader.remaining() / sizeof(u64)) return false;
+        table.offsets.resize(count + 1);
+        return reader.read(table.offsets.data(), table.offsets.size() * sizeof(u64));
+    }
+
+    bool read_chunk(const umbf::RawBlock &data, const ChunkTable &table, u64 index, acul::vector<char> &out)
+    {
+        if (index >= table.count()) return false;
+        const u64 begin = table.offsets[index], end = table.offsets[index + 1];
+        if (end < begin || end > data.data_size) return false;
+        const u64 expected = std::min(table.chunk_size, table.raw_size - index * table.chunk_size);
+        return acul::fs::decompress(data.data + begin, end - begin, out).success() && out.size() == expected;
+    }
+
+    bool read_chunked_range(const umbf::RawBlock &data, const ChunkTable &table, u64 offset, u64 size, u32 jobs,
+                            acul::vector<char> &out)
+    {
+        out.clear();
+        if (offset >= table.raw_size || size == 0) return true;
+        size = std::min(size, table.raw_size - offset);
+        const u64 first = offset / table.chunk_size;
+        const u64 last = (offset + size - 1) / table.chunk_size;
+        if (last >= table.count() || table.offsets.back() > data.data_size) return false;
+        out.resize(size);
+
+        struct Chunk
+        {
+            bool ok = false;
+            acul::vector<char> data;
+        };
+        return run_ordered<Chunk>(
+            static_cast<size_t>(last - first + 1), jobs,
+            [&](size_t i) {
+                Chunk chunk;
+                chunk.ok = read_chunk(data, table, first + i, chunk.data);
+                return chunk;
+            },
+            [&](size_t i, Chunk &chunk) {
+                if (!chunk.ok)
+                {
+                    LOG_ERROR("Failed to decompress chunk %zu", static_cast<size_t>(first + i));
+                    return false;
+                }
+                // Clip the decompressed chunk to the requested range
+                const u64 chunk_begin = (first + i) * table.chunk_size;
+                const u64 from = std::max(offset, chunk_begin);
+                const u64 to = std::min(offset + size, chunk_begin + chunk.data.size());
+                memcpy(out.data() + (from - offset), chunk.data.data() + (from - chunk_begin), to - from);
+                return true;
+            });
+    }
+} // namespace raw
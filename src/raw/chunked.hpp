@@ -0,0 +1,29 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace raw
+{
+    // Seek table of data compressed in independent fixed-size chunks: a chunked raw asset or the solid payload of
+    // a mapped library.
+    // Chunk i holds source bytes [i * chunk_size, min((i + 1) * chunk_size, raw_size)) and is stored compressed
+    // at [offsets[i], offsets[i + 1]) of the data RawBlock.
+    struct ChunkTable
+    {
+        u64 raw_size = 0;
+        u64 chunk_size = 0;
+        acul::vector<u64> offsets;
+
+        size_t count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    };
+
+    acul::shared_ptr<umbf::RawBlock> write_chunk_table(const ChunkTable &table);
+
+    bool read_chunk_table(const umbf::File &file, ChunkTable &table);
+
+    // Decompresses chunk `index` as a whole
+    bool read_chunk(const umbf::RawBlock &data, const ChunkTable &table, u64 index, acul::vector<char> &out);
+
+    // Decompresses only the chunks that cover [offset, offset + size) on `jobs` threads and returns those bytes
+    bool read_chunked_range(const umbf::RawBlock &data, const ChunkTable &table, u64 offset, u64 size, u32 jobs,
+                            acul::vector<char> &out);
+} // namespace raw
@@ -0,0 +1,27 @@
+#include "dedup.hpp"
+#include <cstring>
+#include "../io/mapped_file.hpp"
+
+namespace raw
+{
+    bool DedupIndex::mark_seen(u64 hash)
+    {
+        std::lock_guard<std::mutex> lock(_seen_lock);
+        return !_seen.insert(hash).second;
+    }
+
+    const DedupIndex::Slot *DedupIndex::find(u64 hash, const char *data, size_t size) const
+    {
+        auto it = _slots.find(hash);
+        if (it == _slots.end()) return nullptr;
+        for (const auto &slot : it->second)
+        {
+            if (slot.size != size) continue;
+            if (size == 0) return &slot;
+            io::MappedFile other;
+            if (!other.open(slot.source) || other.size() != size) continue;
+            if (memcmp(other.data(), data, size) == 0) return &slot;
+        }
+        return nullptr;
+    }
+} // namespace raw
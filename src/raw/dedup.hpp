@@ -0,0 +1,47 @@
+#pragma once
+#include <acul/string/string.hpp>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace raw
+{
+    // Content index of a mapped payload. Entries are keyed by the hash of their source bytes; a hit is confirmed
+    // by comparing both sources byte-for-byte before the new entry is pointed at the stored range.
+    class DedupIndex
+    {
+    public:
+        struct Slot
+        {
+            acul::string source;
+            u64 size = 0;
+            u64 offset = 0;
+            u64 stored_size = 0;
+            u8 flags = 0; // Header flags of the stored entry
+        };
+
+        // Thread-safe. Returns true if a source with the same hash was already seen by any worker,
+        // meaning the caller is likely a duplicate and may postpone compressing it.
+        bool mark_seen(u64 hash);
+
+        const Slot *find(u64 hash, const char *data, size_t size) const;
+
+        void insert(u64 hash, const Slot &slot) { _slots[hash].push_back(slot); }
+
+        void add_duplicate(u64 stored_size)
+        {
+            ++_duplicates;
+            _saved_bytes += stored_size;
+        }
+
+        size_t duplicates() const { return _duplicates; }
+        u64 saved_bytes() const { return _saved_bytes; }
+
+    private:
+        std::mutex _seen_lock;
+        std::unordered_set<u64> _seen;
+        std::unordered_map<u64, acul::vector<Slot>> _slots;
+        size_t _duplicates = 0;
+        u64 _saved_bytes = 0;
+    };
+} // namespace raw
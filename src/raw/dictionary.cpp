@@ -0,0 +1,89 @@
+#include "dictionary.hpp"
+#include "aux.hpp"
+#ifdef UMBF_CONVERT_ZSTD_DICT
+    #include <zdict.h>
+    #include <zstd.h>
+#endif
+
+namespace raw
+{
+#ifdef UMBF_CONVERT_ZSTD_DICT
+    Dictionary::~Dictionary()
+    {
+        ZSTD_freeCDict(static_cast<ZSTD_CDict *>(_cdict));
+        ZSTD_freeDDict(static_cast<ZSTD_DDict *>(_ddict));
+    }
+
+    bool Dictionary::supported() { return true; }
+
+    bool Dictionary::train(const acul::vector<char> &samples, const acul::vector<size_t> &sizes, size_t capacity,
+                           int level)
+    {
+        acul::vector<char> buffer(capacity);
+        const size_t size = ZDICT_trainFromBuffer(buffer.data(), buffer.size(), samples.data(), sizes.data(),
+                                                  static_cast<unsigned>(sizes.size()));
+        if (ZDICT_isError(size)) return false;
+        return load(buffer.data(), size, level);
+    }
+
+    bool Dictionary::load(const char *data, size_t size, int level)
+    {
+        ZSTD_freeCDict(static_cast<ZSTD_CDict *>(_cdict));
+        ZSTD_freeDDict(static_cast<ZSTD_DDict *>(_ddict));
+        _data.assign(data, data + size);
+        _cdict = ZSTD_createCDict(_data.data(), _data.size(), level);
+        _ddict = ZSTD_createDDict(_data.data(), _data.size());
+        return _cdict && _ddict;
+    }
+
+    bool Dictionary::compress(const char *data, size_t size, acul::vector<char> &out) const
+    {
+        ZSTD_CCtx *ctx = ZSTD_createCCtx();
+        if (!ctx) return false;
+        out.resize(ZSTD_compressBound(size));
+        const size_t written = ZSTD_compress_usingCDict(ctx, out.data(), out.size(), data, size,
+                                                        static_cast<const ZSTD_CDict *>(_cdict));
+        ZSTD_freeCCtx(ctx);
+        if (ZSTD_isError(written)) return false;
+        out.resize(written);
+        return true;
+    }
+
+    bool Dictionary::decompress(const char *data, size_t size, acul::vector<char> &out) const
+    {
+        const unsigned long long content_size = ZSTD_getFrameContentSize(data, size);
+        if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR) return false;
+        ZSTD_DCtx *ctx = ZSTD_createDCtx();
+        if (!ctx) return false;
+        out.resize(static_cast<size_t>(content_size));
+        const size_t written = ZSTD_decompress_usingDDict(ctx, out.data(), out.size(), data, size,
+                                                          static_cast<const ZSTD_DDict *>(_ddict));
+        ZSTD_freeDCtx(ctx);
+        return !ZSTD_isError(written) && written == out.size();
+    }
+#else
+    Dictionary::~Dictionary() = default;
+
+    bool Dictionary::supported() { return false; }
+
+    bool Dictionary::train(const acul::vector<char> &, const acul::vector<size_t> &, size_t, int) { return false; }
+
+    bool Dictionary::load(const char *, size_t, int) { return false; }
+
+    bool Dictionary::compress(const char *, size_t, acul::vector<char> &) const { return false; }
+
+    bool Dictionary::decompress(const char *, size_t, acul::vector<char> &) const { return false; }
+#endif
+
+    acul::shared_ptr<umbf::RawBlock> write_dictionary(const Dictionary &dictionary)
+    {
+        return make_aux_block(aux_tag::dictionary, dictionary.data());
+    }
+
+    bool read_dictionary(const umbf::File &file, int level, Dictionary &dictionary)
+    {
+        ByteReader reader;
+        if (!find_aux_block(file, aux_tag::dictionary, reader)) return false;
+        return dictionary.load(reader.data(), reader.remaining(), level);
+    }
+} // namespace raw
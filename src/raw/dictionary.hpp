@@ -0,0 +1,42 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace raw
+{
+    // Compression dictionary shared by all entries of a mapped library. It is trained on a sample of the entries
+    // and stored once in the library; every entry is still an independent zstd frame that only needs the
+    // dictionary to be decoded.
+    // Requires zstd with dictionary support at build time (UMBF_CONVERT_ZSTD_DICT), see supported().
+    class Dictionary
+    {
+    public:
+        Dictionary() = default;
+        ~Dictionary();
+
+        Dictionary(const Dictionary &) = delete;
+        Dictionary &operator=(const Dictionary &) = delete;
+
+        static bool supported();
+
+        // Trains a dictionary of at most `capacity` bytes from samples concatenated in `samples`
+        bool train(const acul::vector<char> &samples, const acul::vector<size_t> &sizes, size_t capacity, int level);
+
+        // Uses existing dictionary bytes, e.g. the ones stored in a library
+        bool load(const char *data, size_t size, int level);
+
+        const acul::vector<char> &data() const { return _data; }
+
+        // Both are safe to call from several threads at once
+        bool compress(const char *data, size_t size, acul::vector<char> &out) const;
+        bool decompress(const char *data, size_t size, acul::vector<char> &out) const;
+
+    private:
+        acul::vector<char> _data;
+        void *_cdict = nullptr;
+        void *_ddict = nullptr;
+    };
+
+    acul::shared_ptr<umbf::RawBlock> write_dictionary(const Dictionary &dictionary);
+
+    bool read_dictionary(const umbf::File &file, int level, Dictionary &dictionary);
+} // namespace raw
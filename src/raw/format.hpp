@@ -0,0 +1,33 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace raw
+{
+    // Files whose blocks only this tool can interpret correctly are written with the extended bit set in the type
+    // signature of their header. A stock umbf reader does not know the resulting type and rejects the file instead
+    // of misreading it; the readers of this tool strip the bit and find the layout in the aux blocks (aux.hpp).
+    //
+    // Extended layouts:
+    //  - adaptive mapped library (`--adaptive`): the file keeps UMBF_COMPRESSION_MAPPED_BIT, but only the entries
+    //    whose own header carries that bit are compressed; the others are stored as is. Marked by an empty
+    //    'UEFL' aux block.
+    //  - chunked raw file (`--chunk-size`): a raw file with UMBF_COMPRESSION_MAPPED_BIT whose data block is the
+    //    concatenation of independently compressed chunks. The 'UCHK' aux block holds the uncompressed size, the
+    //    chunk size and the offsets of the chunks in the data block.
+    //  - dictionary library (`--dictionary`): every compressed entry is a zstd frame that needs the dictionary
+    //    stored in the 'UDCT' aux block, both together with the usual UMBF_COMPRESSION_MAPPED_BIT. Libraries whose
+    //    dictionary could not be trained fall back to plain frames and are not marked.
+    //  - solid library (`--solid`): the entries are concatenated uncompressed and that stream is stored compressed
+    //    in independent blocks, with a 'UCHK' aux block as for chunked files. The mappings address the uncompressed
+    //    stream, which is not stored in the file: the block of an entry is offset / chunk size, its position in the
+    //    block the remainder.
+    //  - quantized scene (`--quantize-meshes`): the Mesh block of every quantized object keeps its indices but no
+    //    vertices. Those follow in the 'UMQV' aux block of the object meta, see mesh/quantize.hpp.
+    constexpr u16 extended_type_bit = 0x8000;
+
+    inline u16 extended_type(u16 type_sign) { return type_sign | extended_type_bit; }
+
+    inline u16 base_type(u16 type_sign) { return type_sign & ~extended_type_bit; }
+
+    inline bool is_extended(u16 type_sign) { return (type_sign & extended_type_bit) != 0; }
+} // namespace raw
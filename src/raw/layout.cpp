@@ -0,0 +1,88 @@
+#include "layout.hpp"
+#include <acul/io/fs/file.hpp>
+#include "aux.hpp"
+
+namespace raw
+{
+    bool read_mapped_layout(const umbf::File &file, MappedLayout &layout)
+    {
+        // The payload is the first raw block after the library that is not an aux block, a plain library with
+        // a manifest has none
+        bool library_found = false;
+        const size_t regular = file.blocks.size() - count_aux_blocks(file.blocks);
+        for (size_t i = 0; i < regular; ++i)
+        {
+            const auto &block = file.blocks[i];
+            if (block->signature() == umbf::sign_block::library) library_found = true;
+            else if (library_found && block->signature() == umbf::sign_block::raw)
+            {
+                layout.payload = static_cast<const umbf::RawBlock *>(block.get());
+                break;
+            }
+        }
+        if (!layout.payload) return false;
+        layout.compressed = (file.header.flags & UMBF_COMPRESSION_MAPPED_BIT) != 0;
+        ByteReader reader;
+        layout.entry_flags = find_aux_block(file, aux_tag::entry_flags, reader);
+        layout.solid = layout.compressed && read_chunk_table(file, layout.blocks);
+        if (find_aux_block(file, aux_tag::dictionary, reader))
+        {
+            layout.dictionary = acul::make_shared<Dictionary>();
+            if (!layout.dictionary->load(reader.data(), reader.remaining(), 0)) return false;
+        }
+        return true;
+    }
+
+    bool is_entry_compressed(const MappedLayout &layout, const umbf::File &asset)
+    {
+        if (!layout.compressed) return false;
+        return !layout.entry_flags || (asset.header.flags & UMBF_COMPRESSION_MAPPED_BIT) != 0;
+    }
+
+    namespace
+    {
+        bool read_solid_entry(const MappedLayout &layout, u64 offset, u64 size, acul::vector<char> &data)
+        {
+            const ChunkTable &blocks = layout.blocks;
+            if (offset + size > blocks.raw_size) return false;
+            data.resize(size);
+            u64 written = 0;
+            while (written < size)
+            {
+                const u64 position = offset + written;
+                const u64 index = position / blocks.chunk_size;
+                if (index != layout.cached_block)
+                {
+                    layout.cached_block = UINT64_MAX;
+                    if (!read_chunk(*layout.payload, blocks, index, layout.cached_data)) return false;
+                    layout.cached_block = index;
+                }
+                const u64 inner = position - index * blocks.chunk_size;
+                const u64 count = std::min(size - written, layout.cached_data.size() - inner);
+                memcpy(data.data() + written, layout.cached_data.data() + inner, count);
+                written += count;
+            }
+            return true;
+        }
+    } // namespace
+
+    bool read_mapped_entry(const MappedLayout &layout, const umbf::File &asset, acul::vector<char> &data)
+    {
+        const umbf::Mapping *mapping = nullptr;
+        for (const auto &block : asset.blocks)
+            if (block->signature() == umbf::sign_block::mapping)
+                mapping = static_cast<const umbf::Mapping *>(block.get());
+        if (!mapping) return false;
+        if (layout.solid) return read_solid_entry(layout, mapping->offset, mapping->size, data);
+        if (mapping->offset + mapping->size > layout.payload->data_size) return false;
+
+        const char *stored = layout.payload->data + mapping->offset;
+        if (is_entry_compressed(layout, asset))
+        {
+            if (layout.dictionary) return layout.dictionary->decompress(stored, mapping->size, data);
+            return acul::fs::decompress(stored, mapping->size, data).success();
+        }
+        data.assign(stored, stored + mapping->size);
+        return true;
+    }
+} // namespace raw
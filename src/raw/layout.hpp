@@ -0,0 +1,31 @@
+#pragma once
+#include <umbf/umbf.hpp>
+#include "chunked.hpp"
+#include "dictionary.hpp"
+
+namespace raw
+{
+    // How the entries of a mapped raw library are stored in its shared payload
+    struct MappedLayout
+    {
+        const umbf::RawBlock *payload = nullptr;
+        bool compressed = false;  // Library was built with compression (UMBF_COMPRESSION_MAPPED_BIT)
+        bool entry_flags = false; // Only entries whose own header has the mapped bit are compressed
+        // When present, every compressed entry was compressed against this dictionary
+        acul::shared_ptr<Dictionary> dictionary;
+        // Solid libraries compress the concatenated entries in fixed-size blocks. Mappings then address the
+        // uncompressed stream: the block of an entry is offset / chunk_size and its position in it the remainder.
+        bool solid = false;
+        ChunkTable blocks;
+        // Last decompressed block; entries are extracted in payload order, so neighbours reuse it
+        mutable u64 cached_block = UINT64_MAX;
+        mutable acul::vector<char> cached_data;
+    };
+
+    bool read_mapped_layout(const umbf::File &file, MappedLayout &layout);
+
+    bool is_entry_compressed(const MappedLayout &layout, const umbf::File &asset);
+
+    // Returns the original bytes of a mapped entry
+    bool read_mapped_entry(const MappedLayout &layout, const umbf::File &asset, acul::vector<char> &data);
+} // namespace raw
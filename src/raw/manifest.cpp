@@ -0,0 +1,47 @@
+#include "manifest.hpp"
+#include "aux.hpp"
+
+namespace raw
+{
+    namespace
+    {
+        constexpr u32 manifest_version = 1;
+    }
+
+    acul::shared_ptr<umbf::RawBlock> write_manifest(const Manifest &manifest)
+    {
+        ByteWriter writer;
+        writer.write(manifest_version);
+        writer.write(manifest.settings);
+        writer.write(static_cast<u64>(manifest.entries.size()));
+        for (const auto &entry : manifest.entries)
+        {
+            writer.write(entry.path);
+            writer.write(entry.size);
+            writer.write(entry.mtime);
+            writer.write(entry.hash);
+        }
+        return make_aux_block(aux_tag::manifest, writer.data());
+    }
+
+    bool read_manifest(const umbf::File &file, Manifest &manifest)
+    {
+        ByteReader reader;
+        if (!find_aux_block(file, aux_tag::manifest, reader)) return false;
+        u32 version;
+        u64 count;
+        if (!reader.read(version) || version != manifest_version) return false;
+        if (!reader.read(manifest.settings) || !reader.read(count)) return false;
+        manifest.entries.clear();
+        manifest.entries.reserve(static_cast<size_t>(std::min<u64>(count, reader.remaining())));
+        for (u64 i = 0; i < count; ++i)
+        {
+            ManifestEntry entry;
+            if (!reader.read(entry.path) || !reader.read(entry.size) || !reader.read(entry.mtime) ||
+                !reader.read(entry.hash))
+                return false;
+            manifest.entries.push_back(std::move(entry));
+        }
+        return true;
+    }
+} // namespace raw
@@ -0,0 +1,24 @@
+#pragma once
+#include <umbf/umbf.hpp>
+
+namespace raw
+{
+    // Per-entry record of an incremental raw build: what the source looked like when its stored bytes were made
+    struct ManifestEntry
+    {
+        acul::string path; // Library path, components joined with '/'
+        u64 size = 0;
+        u64 mtime = 0;
+        u64 hash = 0; // hash_bytes() of the source content
+    };
+
+    struct Manifest
+    {
+        u64 settings = 0; // Fingerprint of the options that affect stored bytes
+        acul::vector<ManifestEntry> entries;
+    };
+
+    acul::shared_ptr<umbf::RawBlock> write_manifest(const Manifest &manifest);
+
+    bool read_manifest(const umbf::File &file, Manifest &manifest);
+} // namespace raw
@@ -0,0 +1,79 @@
+#include "payload.hpp"
+#include <cstring>
+
+namespace raw
+{
+    PayloadBuilder::~PayloadBuilder()
+    {
+        if (_data) acul::release(_data);
+        if (_spill_block)
+        {
+            // The block may still be referenced by the file; leave it empty instead of pointing at the mapping
+            _spill_block->data = acul::alloc_n<char>(0);
+            _spill_block->data_size = 0;
+        }
+        _spill_map.close();
+        if (_spill) fclose(_spill);
+        if (!_spill_path.empty()) remove(_spill_path.c_str());
+    }
+
+    bool PayloadBuilder::spill_to(const acul::string &path)
+    {
+        _spill = fopen(path.c_str(), "wb");
+        if (!_spill) return false;
+        _spill_path = path;
+        return true;
+    }
+
+    void PayloadBuilder::reserve(u64 capacity)
+    {
+        if (_spill || capacity <= _capacity) return;
+        char *data = acul::alloc_n<char>(capacity);
+        if (_size > 0) memcpy(data, _data, _size);
+        if (_data) acul::release(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+
+    u64 PayloadBuilder::append(const char *data, size_t size)
+    {
+        const u64 offset = _size;
+        if (_spill)
+        {
+            if (size > 0 && fwrite(data, 1, size, _spill) != size) _failed = true;
+            _size += size;
+            return offset;
+        }
+        // Reached for unreserved (compressed) payloads, or when the reservation was too small
+        if (_size + size > _capacity) reserve(std::max<u64>(_size + size, _capacity + _capacity / 2));
+        if (size > 0) memcpy(_data + _size, data, size);
+        _size += size;
+        return offset;
+    }
+
+    acul::shared_ptr<umbf::RawBlock> PayloadBuilder::release_block()
+    {
+        auto block = acul::make_shared<umbf::RawBlock>();
+        if (_spill)
+        {
+            const bool written = fclose(_spill) == 0 && !_failed;
+            _spill = nullptr;
+            if (!written || (_size > 0 && !_spill_map.open(_spill_path))) return nullptr;
+            if (_size > 0)
+            {
+                block->data = const_cast<char *>(_spill_map.data());
+                _spill_block = block;
+            }
+            else block->data = acul::alloc_n<char>(0);
+            block->data_size = _size;
+            _size = 0;
+            return block;
+        }
+        block->data = _data ? _data : acul::alloc_n<char>(0);
+        block->data_size = _size;
+        _data = nullptr;
+        _size = 0;
+        _capacity = 0;
+        return block;
+    }
+} // namespace raw
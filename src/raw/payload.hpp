@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdio>
+#include <umbf/umbf.hpp>
+#include "../io/mapped_file.hpp"
+
+namespace raw
+{
+    // Builds the shared payload of a mapped library directly in the buffer that the final RawBlock takes over,
+    // so the payload is never held twice. When an upper bound is known (e.g. the sum of stored input sizes) callers
+    // reserve it up front; pages past the written size are never touched and cost no physical memory. Otherwise the
+    // buffer grows geometrically as bytes are appended.
+    //
+    // For payloads larger than memory the builder can spill to a temporary file instead: appended bytes are
+    // streamed to disk and the released block maps that file, so its pages are file-backed and only read while
+    // the library is saved. The block is detached and the file removed when the builder is destroyed, so the
+    // builder must outlive saving the file.
+    class PayloadBuilder
+    {
+    public:
+        PayloadBuilder() = default;
+        ~PayloadBuilder();
+
+        PayloadBuilder(const PayloadBuilder &) = delete;
+        PayloadBuilder &operator=(const PayloadBuilder &) = delete;
+
+        bool spill_to(const acul::string &path);
+
+        void reserve(u64 capacity);
+
+        // Appends bytes and returns the offset they were written at
+        u64 append(const char *data, size_t size);
+
+        u64 size() const { return _size; }
+
+        // A write to the spill file failed; the payload is incomplete
+        bool failed() const { return _failed; }
+
+        // Hands the buffer over to a RawBlock without copying. The builder is empty afterwards.
+        // Returns nullptr if the spilled payload could not be written or mapped.
+        acul::shared_ptr<umbf::RawBlock> release_block();
+
+    private:
+        char *_data = nullptr;
+        u64 _size = 0;
+        u64 _capacity = 0;
+        bool _failed = false;
+        FILE *_spill = nullptr;
+        acul::string _spill_path;
+        io::MappedFile _spill_map;
+        acul::shared_ptr<umbf::RawBlock> _spill_block;
+    };
+} // namespace raw
@@ -1,6 +1,11 @@
 #include <acul/log.hpp>
 #include <inttypes.h>
 #include <umbf/umbf.hpp>
+#include "pixels/atlas.hpp"
+#include "pixels/trim.hpp"
+#include "raw/aux.hpp"
+#include "raw/chunked.hpp"
+#include "raw/format.hpp"
 
 bool print_raw(umbf::File *file)
 {
@@ -23,6 +28,15 @@ bool print_raw(umbf::File *file)
         return false;
     }
     LOG_INFO("Data size: %zu", raw_block->data_size);
+
+    raw::ChunkTable table;
+    if (raw::read_chunk_table(*file, table))
+    {
+        LOG_INFO("-------------chunk table--------------");
+        LOG_INFO("raw size: %" PRIu64, table.raw_size);
+        LOG_INFO("chunk size: %" PRIu64, table.chunk_size);
+        LOG_INFO("chunks: %zu", table.count());
+    }
     return true;
 }
 
@@ -65,6 +79,30 @@ bool print_image(umbf::File *file)
         });
     if (atlas_it != file->blocks.end()) print_image_atlas(acul::static_pointer_cast<umbf::Atlas>(*atlas_it));
 
+    pixels::AtlasPageTable pages;
+    if (pixels::read_page_table(*file, pages))
+    {
+        LOG_INFO("pages: %u", pages.pages);
+        // Only the first page is described above, the others just need their pixels released
+        for (auto page = std::next(it); page != file->blocks.end(); ++page)
+            if ((*page)->signature() == umbf::sign_block::image)
+                acul::release(acul::static_pointer_cast<umbf::Image2D>(*page)->pixels);
+    }
+
+    pixels::SpriteTable sprites;
+    if (pixels::read_sprite_table(*file, sprites))
+    {
+        size_t aliases = 0, rotated = 0;
+        for (size_t i = 0; i < sprites.sprites.size(); ++i)
+        {
+            if (sprites.sprites[i].alias != i) ++aliases;
+            if (sprites.sprites[i].flags & pixels::sprite_rotated) ++rotated;
+        }
+        LOG_INFO("sprites: %zu", sprites.sprites.size());
+        LOG_INFO("aliases: %zu", aliases);
+        LOG_INFO("rotated: %zu", rotated);
+    }
+
     return true;
 }
 
@@ -231,9 +269,46 @@ void print_file_hierarchy(const umbf::Library::Node &node, int depth = 0, const
                              i == node.children.size() - 1 ? prefix + (depth > 0 ? "      " : "") : newPrefix);
 }
 
+void collect_mappings(const umbf::Library::Node &node, acul::vector<acul::shared_ptr<umbf::Mapping>> &mappings)
+{
+    for (const auto &block : node.asset.blocks)
+        if (block->signature() == umbf::sign_block::mapping)
+            mappings.push_back(acul::static_pointer_cast<umbf::Mapping>(block));
+    for (const auto &child : node.children) collect_mappings(child, mappings);
+}
+
+// Entries that share a payload range were deduplicated at build time; the bytes they would otherwise have
+// taken are reported as saved.
+void print_mapping_stats(const umbf::Library &library)
+{
+    acul::vector<acul::shared_ptr<umbf::Mapping>> mappings;
+    collect_mappings(library.file_tree, mappings);
+    if (mappings.empty()) return;
+
+    std::sort(mappings.begin(), mappings.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs->offset != rhs->offset ? lhs->offset < rhs->offset : lhs->size < rhs->size;
+    });
+    u64 total = 0, unique = 0;
+    size_t unique_count = 0;
+    for (size_t i = 0; i < mappings.size(); ++i)
+    {
+        total += mappings[i]->size;
+        if (i > 0 && mappings[i]->offset == mappings[i - 1]->offset && mappings[i]->size == mappings[i - 1]->size)
+            continue;
+        unique += mappings[i]->size;
+        ++unique_count;
+    }
+    LOG_INFO("------------mapping info--------------");
+    LOG_INFO("mapped entries: %zu (%zu unique)", mappings.size(), unique_count);
+    LOG_INFO("mapped size: %" PRIu64, total);
+    LOG_INFO("payload size: %" PRIu64, unique);
+    LOG_INFO("dedup saved: %" PRIu64 " bytes", total - unique);
+}
+
 bool print_library(umbf::File *file)
 {
-    if (file->header.vendor_sign != UMBF_VENDOR_ID || file->header.type_sign != umbf::sign_block::format::library)
+    if (file->header.vendor_sign != UMBF_VENDOR_ID ||
+        raw::base_type(file->header.type_sign) != umbf::sign_block::format::library)
     {
         LOG_ERROR("Unsupported file type: %x", file->header.type_sign);
         return false;
@@ -255,6 +330,13 @@ bool print_library(umbf::File *file)
     }
     else
         print_file_hierarchy(library->file_tree);
+    print_mapping_stats(*library);
+    raw::ByteReader dictionary;
+    if (raw::find_aux_block(*file, raw::aux_tag::dictionary, dictionary))
+        LOG_INFO("shared dictionary: %zu bytes", dictionary.remaining());
+    raw::ChunkTable blocks;
+    if (raw::read_chunk_table(*file, blocks))
+        LOG_INFO("solid blocks: %zu of %" PRIu64 " bytes", blocks.count(), blocks.chunk_size);
     return true;
 }
 
@@ -274,8 +356,9 @@ bool show_file(const acul::string &path)
     LOG_INFO("flags: 0x%02x", file->header.flags);
     LOG_INFO("checksum: %u", file->checksum);
     if (file->header.vendor_sign != UMBF_VENDOR_ID) return true;
+    if (raw::is_extended(file->header.type_sign)) LOG_INFO("layout: extended");
 
-    switch (file->header.type_sign)
+    switch (raw::base_type(file->header.type_sign))
     {
         case umbf::sign_block::format::image:
             return print_image(file.get());
@@ -0,0 +1,38 @@
+# Helpers shared by the test scripts
+
+# Runs a command and fails the test if it does not succeed; its combined output is returned in `output`
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Command failed (${result}): ${ARGN}\n${output}")
+    endif()
+    set(output "${output}" PARENT_SCOPE)
+endfunction()
+
+function(compare_files EXPECTED ACTUAL)
+    file(SHA256 ${EXPECTED} expected_hash)
+    file(SHA256 ${ACTUAL} actual_hash)
+    if(NOT expected_hash STREQUAL actual_hash)
+        message(FATAL_ERROR "Files differ: ${EXPECTED} ${ACTUAL}")
+    endif()
+endfunction()
+
+# Both directories must hold the same relative paths with the same content
+function(compare_trees EXPECTED ACTUAL)
+    file(GLOB_RECURSE expected_files RELATIVE ${EXPECTED} ${EXPECTED}/*)
+    file(GLOB_RECURSE actual_files RELATIVE ${ACTUAL} ${ACTUAL}/*)
+    list(SORT expected_files)
+    list(SORT actual_files)
+    if(NOT expected_files STREQUAL actual_files)
+        message(FATAL_ERROR "Directory trees differ:\n${expected_files}\n${actual_files}")
+    endif()
+    foreach(relative ${expected_files})
+        compare_files(${EXPECTED}/${relative} ${ACTUAL}/${relative})
+    endforeach()
+endfunction()
+
+function(expect_output PATTERN)
+    if(NOT output MATCHES "${PATTERN}")
+        message(FATAL_ERROR "Output does not match '${PATTERN}':\n${output}")
+    endif()
+endfunction()
@@ -0,0 +1,75 @@
+# Checks that --incremental reuses unchanged entries of the previous output and that the result does not depend on
+# it: a rebuild over an unchanged tree is byte-identical to its input, and a rebuild after a file changed is
+# byte-identical to a full build of the changed tree. OPTIONS ('|'-separated) are passed to every convert run.
+#   cmake -DTOOL=<umbf-convert> -DINPUT=<dir> -DWORK=<dir> [-DOPTIONS=...] -P incremental.cmake
+
+include(${CMAKE_CURRENT_LIST_DIR}/common.cmake)
+
+string(REPLACE "|" ";" options "${OPTIONS}")
+set(tree ${WORK}/tree)
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+file(COPY ${INPUT}/ DESTINATION ${tree})
+file(GLOB_RECURSE entries ${tree}/*)
+list(LENGTH entries count)
+math(EXPR count_changed "${count} - 1")
+
+function(convert OUTPUT PREVIOUS)
+    run(${TOOL} convert -i ${tree} -o ${WORK}/${OUTPUT} --format=raw -R ${options} --incremental ${WORK}/${PREVIOUS})
+    set(output "${output}" PARENT_SCOPE)
+endfunction()
+
+function(expect_extracted PACKED)
+    file(REMOVE_RECURSE ${WORK}/extracted)
+    file(MAKE_DIRECTORY ${WORK}/extracted)
+    run(${TOOL} extract -i ${WORK}/${PACKED} -o ${WORK}/extracted)
+    compare_trees(${tree} ${WORK}/extracted)
+endfunction()
+
+# No previous output: full build
+convert(first.umbf missing.umbf)
+expect_output("doing a full build")
+
+# Unchanged tree: every entry is taken from the previous output, which is reproduced exactly
+convert(unchanged.umbf first.umbf)
+expect_output("Reused ${count} of ${count} entries")
+compare_files(${WORK}/first.umbf ${WORK}/unchanged.umbf)
+expect_extracted(unchanged.umbf)
+
+# Touched but not modified: reused after comparing the content hash
+file(TOUCH ${tree}/docs/notes.txt)
+convert(touched.umbf unchanged.umbf)
+expect_output("Reused ${count} of ${count} entries")
+expect_extracted(touched.umbf)
+
+# One file changed: the other entries are reused and the result equals a full build of the changed tree
+file(APPEND ${tree}/config/item_00.json "\n")
+convert(changed.umbf touched.umbf)
+expect_output("Reused ${count_changed} of ${count} entries")
+convert(changed_full.umbf missing.umbf)
+compare_files(${WORK}/changed_full.umbf ${WORK}/changed.umbf)
+expect_extracted(changed.umbf)
+
+# A different solid block size changes the layout of the stored bytes, so nothing may be reused
+if("--mapped" IN_LIST options AND "--compressed" IN_LIST options)
+    run(${TOOL} convert -i ${tree} -o ${WORK}/solid.umbf --format=raw -R ${options} --solid 65536
+        --incremental ${WORK}/changed.umbf)
+    expect_output("Conversion options changed")
+    expect_extracted(solid.umbf)
+endif()
+
+# Same size and modification time: the entry is trusted without being read, so the previous content is extracted.
+# This proves the payload comes from the previous output; it needs touch to restore the modification time.
+find_program(TOUCH_PROGRAM touch)
+if(TOUCH_PROGRAM)
+    set(forged ${tree}/nested/a/b/c/deep.txt)
+    file(READ ${forged} original)
+    run(${TOUCH_PROGRAM} -r ${forged} ${WORK}/mtime.ref)
+    string(TOUPPER "${original}" modified)
+    file(WRITE ${forged} "${modified}")
+    run(${TOUCH_PROGRAM} -r ${WORK}/mtime.ref ${forged})
+    convert(forged.umbf changed.umbf)
+    expect_output("Reused ${count} of ${count} entries")
+    file(WRITE ${forged} "${original}")
+    expect_extracted(forged.umbf)
+endif()
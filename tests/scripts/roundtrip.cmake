@@ -0,0 +1,30 @@
+# Converts INPUT into a raw UMBF file, extracts it again and checks that the result is identical to the input, file
+# by file for directories. OPTIONS are passed to convert, every pattern of SHOW_MATCH must be found in the output of
+# show; both are '|'-separated lists.
+#   cmake -DTOOL=<umbf-convert> -DINPUT=<path> -DWORK=<dir> [-DOPTIONS=...] [-DSHOW_MATCH=...] -P roundtrip.cmake
+
+include(${CMAKE_CURRENT_LIST_DIR}/common.cmake)
+
+string(REPLACE "|" ";" options "${OPTIONS}")
+string(REPLACE "|" ";" show_match "${SHOW_MATCH}")
+set(packed ${WORK}/packed.umbf)
+set(extracted ${WORK}/extracted)
+file(REMOVE_RECURSE ${WORK})
+file(MAKE_DIRECTORY ${WORK})
+
+run(${TOOL} convert -i ${INPUT} -o ${packed} --format=raw ${options})
+if(show_match)
+    run(${TOOL} show -i ${packed})
+    foreach(pattern ${show_match})
+        expect_output("${pattern}")
+    endforeach()
+endif()
+
+if(IS_DIRECTORY ${INPUT})
+    file(MAKE_DIRECTORY ${extracted})
+    run(${TOOL} extract -i ${packed} -o ${extracted})
+    compare_trees(${INPUT} ${extracted})
+else()
+    run(${TOOL} extract -i ${packed} -o ${extracted})
+    compare_files(${INPUT} ${extracted})
+endif()
@@ -0,0 +1,77 @@
+#include <acul/log.hpp>
+#include <cstring>
+#include <exception>
+#include <umbf/log.hpp>
+#include <umbf/umbf.hpp>
+#include "unit.hpp"
+
+namespace unit
+{
+    namespace
+    {
+        acul::string data_dir, output_dir;
+    }
+
+    acul::vector<Test> &tests()
+    {
+        static acul::vector<Test> registered;
+        return registered;
+    }
+
+    acul::string data_path(const acul::string &relative) { return data_dir + "/" + relative; }
+
+    acul::string output_path(const acul::string &relative) { return output_dir + "/" + relative; }
+} // namespace unit
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: %s <test> <fixtures dir> <output dir>\n", argv[0]);
+        return 2;
+    }
+    unit::data_dir = argv[2];
+    unit::output_dir = argv[3];
+    auto it = std::find_if(unit::tests().begin(), unit::tests().end(),
+                           [&](const unit::Test &test) { return strcmp(test.name, argv[1]) == 0; });
+    if (it == unit::tests().end())
+    {
+        fprintf(stderr, "Unknown test: %s\n", argv[1]);
+        return 2;
+    }
+
+    // Same services as the tool itself, the code under test logs and reads umbf files
+    acul::task::service_dispatch sd;
+    sd.run();
+    acul::log::log_service *log_service = acul::alloc<acul::log::log_service>();
+    sd.register_service(log_service);
+    auto *app_log = log_service->add_logger<acul::log::console_logger>("app");
+    log_service->level = acul::log::level::info;
+    app_log->set_pattern("%(message)\n");
+    acul::log::set_default_logger(app_log);
+    umbf::attach_logger(log_service, app_log);
+    umbf::streams::HashResolver meta_resolver;
+    meta_resolver.streams = {{umbf::sign_block::raw, &umbf::streams::raw_block},
+                             {umbf::sign_block::image, &umbf::streams::image},
+                             {umbf::sign_block::image_atlas, &umbf::streams::image_atlas},
+                             {umbf::sign_block::material, &umbf::streams::material},
+                             {umbf::sign_block::material_info, &umbf::streams::material_info},
+                             {umbf::sign_block::scene, &umbf::streams::scene},
+                             {umbf::sign_block::mesh, &umbf::streams::mesh},
+                             {umbf::sign_block::target, &umbf::streams::target},
+                             {umbf::sign_block::library, &umbf::streams::library},
+                             {umbf::sign_block::mapping, &umbf::streams::mapping_block}};
+    umbf::streams::resolver = &meta_resolver;
+
+    bool passed = false;
+    try
+    {
+        passed = it->run();
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "%s: %s\n", it->name, e.what());
+    }
+    log_service->await();
+    return passed ? 0 : 1;
+}
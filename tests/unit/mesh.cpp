@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include "convert.hpp"
+#include "mesh/optimize.hpp"
+#include "mesh/quantize.hpp"
+#include "raw/format.hpp"
+#include "unit.hpp"
+
+namespace
+{
+    const umbf::Mesh *find_mesh(const umbf::Object &object)
+    {
+        for (const auto &block : object.meta)
+            if (block->signature() == umbf::sign_block::mesh) return static_cast<const umbf::Mesh *>(block.get());
+        return nullptr;
+    }
+
+    // Position of every triangle corner, through the index buffer if there is one
+    acul::vector<amal::vec3> corners(const umbf::Mesh::Model &model)
+    {
+        acul::vector<amal::vec3> positions;
+        if (model.indices.empty())
+            for (const auto &vertex : model.vertices) positions.push_back(vertex.pos);
+        else
+            for (u32 index : model.indices)
+                if (index < model.vertices.size()) positions.push_back(model.vertices[index].pos);
+        return positions;
+    }
+} // namespace
+
+UNIT_TEST(mesh_import_obj)
+{
+    const auto importer = import_mesh(unit::data_path("meshes/quad.obj"));
+    UNIT_CHECK(importer && importer->objects().size() == 1);
+    const umbf::Mesh *mesh = find_mesh(importer->objects().front());
+    UNIT_CHECK(mesh);
+
+    // Two triangles on the corners of the unit quad, each corner used at least once
+    const auto positions = corners(mesh->model);
+    UNIT_CHECK(positions.size() == 6);
+    for (const auto &position : positions)
+        UNIT_CHECK((position.x == 0.0f || position.x == 1.0f) && (position.y == 0.0f || position.y == 1.0f) &&
+                   position.z == 0.0f);
+    for (const amal::vec3 corner : {amal::vec3{0, 0, 0}, amal::vec3{1, 0, 0}, amal::vec3{1, 1, 0}, amal::vec3{0, 1, 0}})
+        UNIT_CHECK(std::any_of(positions.begin(), positions.end(), [&](const amal::vec3 &position) {
+            return position.x == corner.x && position.y == corner.y && position.z == corner.z;
+        }));
+
+    UNIT_CHECK(!import_mesh(unit::data_path("meshes/missing.obj")));
+    UNIT_CHECK(!import_mesh(unit::data_path("images/small.png")));
+    return true;
+}
+
+namespace
+{
+    using Triangle = std::array<std::array<f32, 3>, 3>;
+
+    // Corner positions of every triangle, each rotated to start at its smallest corner so the winding is kept,
+    // sorted into a multiset
+    acul::vector<Triangle> triangles(const umbf::Mesh::Model &model)
+    {
+        const auto positions = corners(model);
+        acul::vector<Triangle> result;
+        for (size_t i = 0; i + 2 < positions.size(); i += 3)
+        {
+            Triangle triangle;
+            for (size_t c = 0; c < 3; ++c)
+                triangle[c] = {positions[i + c].x, positions[i + c].y, positions[i + c].z};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            result.push_back(triangle);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Index distance walked between consecutive fetches
+    u64 fetch_distance(const acul::vector<u32> &indices)
+    {
+        u64 distance = 0;
+        for (size_t i = 1; i < indices.size(); ++i)
+            distance += indices[i] > indices[i - 1] ? indices[i] - indices[i - 1] : indices[i - 1] - indices[i];
+        return distance;
+    }
+} // namespace
+
+UNIT_TEST(mesh_optimize)
+{
+    // A 16x16 grid exported without shared vertices: every quad has its own four corners, and the triangles are
+    // shuffled, which is about the worst input for the caches
+    constexpr u32 grid = 16;
+    umbf::Mesh mesh;
+    auto &model = mesh.model;
+    acul::vector<std::array<u32, 3>> faces;
+    for (u32 y = 0; y < grid; ++y)
+        for (u32 x = 0; x < grid; ++x)
+        {
+            const u32 base = static_cast<u32>(model.vertices.size());
+            for (const auto &[dx, dy] : {std::pair{0u, 0u}, {1u, 0u}, {1u, 1u}, {0u, 1u}})
+            {
+                umbf::Vertex vertex{};
+                vertex.pos = {static_cast<f32>(x + dx), static_cast<f32>(y + dy), 0.0f};
+                vertex.uv = {static_cast<f32>(x + dx) / grid, static_cast<f32>(y + dy) / grid};
+                vertex.normal = {0.0f, 0.0f, 1.0f};
+                model.vertices.push_back(vertex);
+            }
+            faces.push_back({base, base + 1, base + 2});
+            faces.push_back({base, base + 2, base + 3});
+        }
+    // One degenerate triangle, which has nothing to render and is dropped
+    faces.push_back({0, 1, 1});
+    std::shuffle(faces.begin(), faces.end(), std::mt19937(5));
+    for (const auto &face : faces) model.indices.insert(model.indices.end(), face.begin(), face.end());
+
+    auto expected = triangles(model);
+    const Triangle degenerate = {{{0, 0, 0}, {1, 0, 0}, {1, 0, 0}}};
+    expected.erase(std::find(expected.begin(), expected.end(), degenerate));
+    const u64 distance_before = fetch_distance(model.indices);
+    mesh::OptimizeStats stats;
+    mesh::optimize(mesh, stats);
+
+    // Welded down to the grid points, with the same triangles in the same winding
+    UNIT_CHECK(model.vertices.size() == (grid + 1) * (grid + 1));
+    UNIT_CHECK(triangles(model) == expected);
+    UNIT_CHECK(stats.triangles_after == grid * grid * 2 && stats.bytes_after < stats.bytes_before);
+
+    // The vertex cache misses no more often, and vertices are stored in the order they are first fetched
+    UNIT_CHECK(stats.acmr_after() <= stats.acmr_before());
+    UNIT_CHECK(stats.transforms_after == mesh::cache_misses(model.indices, model.vertices.size()));
+    UNIT_CHECK(fetch_distance(model.indices) <= distance_before);
+    u32 first_unused = 0;
+    for (u32 index : model.indices)
+    {
+        UNIT_CHECK(index <= first_unused);
+        if (index == first_unused) ++first_unused;
+    }
+    UNIT_CHECK(first_unused == model.vertices.size());
+    return true;
+}
+
+UNIT_TEST(mesh_quantize)
+{
+    // Vertices spread over uneven bounds, normals over the whole sphere including both octahedron halves
+    std::mt19937 random(3);
+    std::uniform_real_distribution<f32> coordinate(-1.0f, 1.0f);
+    auto mesh = acul::make_shared<umbf::Mesh>();
+    auto &model = mesh->model;
+    for (u32 i = 0; i < 3000; ++i)
+    {
+        umbf::Vertex vertex{};
+        vertex.pos = {coordinate(random) * 100.0f + 50.0f, coordinate(random) * 0.5f, coordinate(random) * 3.0f};
+        vertex.uv = {coordinate(random) * 0.5f + 0.5f, coordinate(random) * 4.0f};
+        amal::vec3 normal{coordinate(random), coordinate(random), coordinate(random)};
+        const f32 length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        vertex.normal = length > 0.01f ? amal::vec3{normal.x / length, normal.y / length, normal.z / length}
+                                       : amal::vec3{0.0f, 0.0f, -1.0f};
+        model.vertices.push_back(vertex);
+        model.indices.push_back(i);
+    }
+    const acul::vector<umbf::Vertex> source = model.vertices;
+    const acul::vector<u32> indices = model.indices;
+    umbf::Object object;
+    object.meta.push_back(mesh);
+
+    // Only the indices stay in the mesh block, the vertices move to the aux block
+    UNIT_CHECK(mesh::quantize_object(object));
+    UNIT_CHECK(model.vertices.empty() && model.indices == indices);
+    UNIT_CHECK(mesh::dequantize_object(object));
+    UNIT_CHECK(model.vertices.size() == source.size() && model.indices == indices);
+
+    // Positions and UVs are off by at most half a step of their bounds, normals by a few hundredths of a degree
+    amal::vec3 min = source.front().pos, max = source.front().pos;
+    amal::vec2 uv_min = source.front().uv, uv_max = source.front().uv;
+    for (const auto &vertex : source)
+    {
+        min = {std::min(min.x, vertex.pos.x), std::min(min.y, vertex.pos.y), std::min(min.z, vertex.pos.z)};
+        max = {std::max(max.x, vertex.pos.x), std::max(max.y, vertex.pos.y), std::max(max.z, vertex.pos.z)};
+        uv_min = {std::min(uv_min.x, vertex.uv.x), std::min(uv_min.y, vertex.uv.y)};
+        uv_max = {std::max(uv_max.x, vertex.uv.x), std::max(uv_max.y, vertex.uv.y)};
+    }
+    // Half a step, plus the rounding of the float arithmetic at the magnitude of the values
+    auto tolerance = [](f32 low, f32 high) {
+        return (high - low) / 65535.0f * 0.5f + std::max(std::abs(low), std::abs(high)) * 1e-6f;
+    };
+    const f32 max_angle = 0.05f * 3.14159265f / 180.0f;
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        const umbf::Vertex &expected = source[i], &actual = model.vertices[i];
+        UNIT_CHECK(std::abs(actual.pos.x - expected.pos.x) <= tolerance(min.x, max.x));
+        UNIT_CHECK(std::abs(actual.pos.y - expected.pos.y) <= tolerance(min.y, max.y));
+        UNIT_CHECK(std::abs(actual.pos.z - expected.pos.z) <= tolerance(min.z, max.z));
+        UNIT_CHECK(std::abs(actual.uv.x - expected.uv.x) <= tolerance(uv_min.x, uv_max.x));
+        UNIT_CHECK(std::abs(actual.uv.y - expected.uv.y) <= tolerance(uv_min.y, uv_max.y));
+        const f32 cosine = actual.normal.x * expected.normal.x + actual.normal.y * expected.normal.y +
+                           actual.normal.z * expected.normal.z;
+        UNIT_CHECK(cosine >= std::cos(max_angle));
+    }
+
+    // A quantized scene file is marked, so readers without the aux block reject it instead of finding no vertices
+    const acul::string output = unit::output_path("mesh_quantize.umbf");
+    MeshOptions options;
+    options.quantize = true;
+    UNIT_CHECK(convert_scene(unit::data_path("meshes/quad.obj"), output, false, options) != 0);
+    acul::shared_ptr<umbf::File> file;
+    UNIT_CHECK(umbf::File::read_from_disk(output, file).success());
+    UNIT_CHECK(raw::is_extended(file->header.type_sign));
+    UNIT_CHECK(raw::base_type(file->header.type_sign) == umbf::sign_block::format::scene);
+    return true;
+}
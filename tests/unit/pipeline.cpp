@@ -0,0 +1,66 @@
+#include <cstring>
+#include <stdexcept>
+#include "pipeline.hpp"
+#include "unit.hpp"
+
+namespace
+{
+    // Runs `body` and tells whether it threw the runtime_error with `message`
+    template <typename Body>
+    bool throws(const char *message, Body &&body)
+    {
+        try
+        {
+            body();
+        }
+        catch (const std::runtime_error &e)
+        {
+            return strcmp(e.what(), message) == 0;
+        }
+        return false;
+    }
+} // namespace
+
+UNIT_TEST(pipeline_exceptions)
+{
+    constexpr size_t count = 200;
+    for (const u32 jobs : {1u, 4u})
+    {
+        // Results still arrive in order when nothing throws
+        size_t expected = 0;
+        const bool ordered = run_ordered<size_t>(
+            count, jobs, [](size_t i) { return i * 3; },
+            [&](size_t i, size_t &value) { return i == expected++ && value == i * 3; });
+        UNIT_CHECK(ordered && expected == count);
+
+        // A throwing worker or consumer reaches the caller instead of terminating the process
+        size_t consumed = 0;
+        UNIT_CHECK(throws("produce", [&] {
+            run_ordered<size_t>(
+                count, jobs,
+                [](size_t i) {
+                    if (i == 57) throw std::runtime_error("produce");
+                    return i;
+                },
+                [&](size_t, size_t &) {
+                    ++consumed;
+                    return true;
+                });
+        }));
+        UNIT_CHECK(consumed == 57);
+        UNIT_CHECK(throws("consume", [&] {
+            run_ordered<size_t>(
+                count, jobs, [](size_t i) { return i; },
+                [](size_t i, size_t &) {
+                    if (i == 31) throw std::runtime_error("consume");
+                    return true;
+                });
+        }));
+        UNIT_CHECK(throws("parallel", [&] {
+            parallel_for(count, jobs, [](size_t i) {
+                if (i % 50 == 7) throw std::runtime_error("parallel");
+            });
+        }));
+    }
+    return true;
+}
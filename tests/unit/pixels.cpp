@@ -0,0 +1,340 @@
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <umbf/utils.hpp>
+#include "convert.hpp"
+#include "pixels/atlas.hpp"
+#include "pixels/cache.hpp"
+#include "pixels/trim.hpp"
+#include "pixels/kernels.hpp"
+#include "pixels/pack.hpp"
+#include "unit.hpp"
+
+namespace
+{
+    // The layout holds every input rect, in input order and at its size (rotated only if allowed), inside the
+    // atlas and without overlaps including the padding
+    bool is_valid_layout(const acul::vector<amal::irect> &input, const pixels::AtlasLayout &layout, i32 padding,
+                         bool rotate)
+    {
+        if (layout.rects.size() != input.size() || layout.size.x != layout.size.y) return false;
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            const amal::irect &rect = layout.rects[i];
+            const bool same = rect.size.x == input[i].size.x && rect.size.y == input[i].size.y;
+            const bool rotated = rect.size.x == input[i].size.y && rect.size.y == input[i].size.x;
+            if (!same && !(rotate && rotated)) return false;
+            if (rect.pos.x < padding || rect.pos.y < padding || rect.pos.x + rect.size.x + padding > layout.size.x ||
+                rect.pos.y + rect.size.y + padding > layout.size.y)
+                return false;
+            for (size_t j = 0; j < i; ++j)
+            {
+                const amal::irect &other = layout.rects[j];
+                if (rect.pos.x < other.pos.x + other.size.x + padding * 2 &&
+                    other.pos.x < rect.pos.x + rect.size.x + padding * 2 &&
+                    rect.pos.y < other.pos.y + other.size.y + padding * 2 &&
+                    other.pos.y < rect.pos.y + rect.size.y + padding * 2)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    acul::vector<amal::irect> make_rects(std::initializer_list<amal::ivec2> sizes)
+    {
+        acul::vector<amal::irect> rects;
+        for (const auto &size : sizes) rects.push_back({{0, 0}, size});
+        return rects;
+    }
+} // namespace
+
+UNIT_TEST(pixels_min_atlas_size)
+{
+    const pixels::PackMode mode;
+
+    // Four equal squares pack at the area lower bound
+    auto squares = make_rects({{32, 32}, {32, 32}, {32, 32}, {32, 32}});
+    auto layout = pixels::find_min_square_atlas_size(squares, 0, 1, mode);
+    UNIT_CHECK(layout.size.x == 64 && is_valid_layout(squares, layout, 0, false));
+
+    // Without rotation no two of these fit side by side below 120, so the search has to grow from the bound (85)
+    auto wide = make_rects({{60, 40}, {60, 40}, {60, 40}});
+    layout = pixels::find_min_square_atlas_size(wide, 0, 4, mode);
+    UNIT_CHECK(layout.size.x == 120 && is_valid_layout(wide, layout, 0, false));
+
+    // Mixed sizes with padding: the result packs, one pixel less does not, and it does not depend on the job count
+    acul::vector<amal::irect> mixed;
+    u32 seed = 12345;
+    for (int i = 0; i < 40; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        mixed.push_back({{0, 0}, {static_cast<i32>(4 + (seed >> 8) % 60), static_cast<i32>(4 + (seed >> 20) % 60)}});
+    }
+    layout = pixels::find_min_square_atlas_size(mixed, 2, 1, mode);
+    UNIT_CHECK(is_valid_layout(mixed, layout, 2, false));
+    acul::vector<amal::irect> packed;
+    UNIT_CHECK(!pixels::pack_atlas(mixed, 2, layout.size.x - 1, mode, packed));
+    const auto parallel = pixels::find_min_square_atlas_size(mixed, 2, 4, mode);
+    UNIT_CHECK(parallel.size.x == layout.size.x);
+    for (size_t i = 0; i < mixed.size(); ++i)
+    {
+        UNIT_CHECK(parallel.rects[i].pos.x == layout.rects[i].pos.x);
+        UNIT_CHECK(parallel.rects[i].pos.y == layout.rects[i].pos.y);
+    }
+    return true;
+}
+
+namespace
+{
+    umbf::ImageFormat make_format(u8 type, u8 bytes_per_channel)
+    {
+        umbf::ImageFormat format;
+        format.type = type;
+        format.bytes_per_channel = bytes_per_channel;
+        return format;
+    }
+
+    umbf::Image2D make_image(const umbf::ImageFormat &format, size_t channels, u16 width, u16 height,
+                             std::mt19937 &random)
+    {
+        umbf::Image2D image;
+        image.width = width;
+        image.height = height;
+        image.format = format;
+        image.channels = {"R", "G", "B", "A"};
+        image.channels.resize(channels);
+        const size_t count = static_cast<size_t>(image.width) * image.height * channels;
+        if (format.bytes_per_channel == 1)
+        {
+            u8 *pixels = acul::alloc_n<u8>(count);
+            for (size_t i = 0; i < count; ++i) pixels[i] = static_cast<u8>(random());
+            image.pixels = pixels;
+            return image;
+        }
+        // Normalized colors plus HDR and tiny values that round differently in half precision
+        f32 *pixels = acul::alloc_n<f32>(count);
+        std::uniform_real_distribution<f32> exponent(-20.0f, 8.0f);
+        for (size_t i = 0; i < count; ++i)
+            pixels[i] = i % 3 == 0 ? static_cast<f32>(random()) / 4294967296.0f
+                                   : std::ldexp(static_cast<f32>(random()) / 4294967296.0f, exponent(random));
+        image.pixels = pixels;
+        return image;
+    }
+} // namespace
+
+// Every conversion the kernels take over must produce the bytes of the generic umbf converter they replace
+UNIT_TEST(pixels_convert_parity)
+{
+    using Type = umbf::ImageFormat::Type;
+    const umbf::ImageFormat u8_format = make_format(Type::uint, 1), f16_format = make_format(Type::sfloat, 2),
+                            f32_format = make_format(Type::sfloat, 4);
+    struct Case
+    {
+        umbf::ImageFormat src, dst;
+        size_t src_channels, dst_channels;
+    };
+    const Case cases[] = {
+        {u8_format, u8_format, 3, 4},   {u8_format, f32_format, 3, 3},  {u8_format, f32_format, 3, 4},
+        {u8_format, f32_format, 4, 4},  {u8_format, f16_format, 3, 3},  {u8_format, f16_format, 3, 4},
+        {u8_format, f16_format, 4, 4},  {f32_format, f32_format, 3, 4}, {f32_format, f16_format, 3, 3},
+        {f32_format, f16_format, 3, 4}, {f32_format, f16_format, 4, 4}};
+    std::mt19937 random(7);
+    for (const auto &test : cases)
+    {
+        // Odd width, so the vector loops leave a scalar tail on every row
+        umbf::Image2D image = make_image(test.src, test.src_channels, 37, 5, random);
+        void *expected = umbf::utils::convert_image(image, test.dst, test.dst_channels);
+        void *actual = pixels::convert(image, test.dst, test.dst_channels);
+        const size_t size =
+            static_cast<size_t>(image.width) * image.height * test.dst_channels * test.dst.bytes_per_channel;
+        const bool same = expected && actual && memcmp(expected, actual, size) == 0;
+        if (!same)
+            fprintf(stderr, "%u-byte x%zu -> %u-byte x%zu differs from umbf::utils::convert_image\n",
+                    test.src.bytes_per_channel, test.src_channels, test.dst.bytes_per_channel, test.dst_channels);
+        acul::release(image.pixels);
+        if (expected) acul::release(expected);
+        if (actual) acul::release(actual);
+        UNIT_CHECK(same);
+    }
+    return true;
+}
+
+// The banded fill and the one-sprite blit replace umbf::fill_atlas_pixels and must reproduce its pixels, padding ring
+// included, for any number of jobs
+UNIT_TEST(pixels_fill_atlas_parity)
+{
+    std::mt19937 random(11);
+    for (const u8 bytes_per_channel : {u8(1), u8(4)})
+    {
+        const umbf::ImageFormat format =
+            make_format(bytes_per_channel == 1 ? umbf::ImageFormat::Type::uint : umbf::ImageFormat::Type::sfloat,
+                        bytes_per_channel);
+        acul::vector<acul::shared_ptr<umbf::Image2D>> sprites;
+        auto atlas = acul::make_shared<umbf::Atlas>();
+        atlas->padding = 1;
+        for (int i = 0; i < 30; ++i)
+        {
+            const u16 width = static_cast<u16>(1 + random() % 40), height = static_cast<u16>(1 + random() % 40);
+            auto sprite = acul::make_shared<umbf::Image2D>(make_image(format, 4, width, height, random));
+            sprites.push_back(sprite);
+            atlas->pack_data.push_back({{-1, -1}, {sprite->width, sprite->height}});
+        }
+        const auto layout = pixels::find_min_square_atlas_size(atlas->pack_data, atlas->padding, 1, {});
+        atlas->pack_data = layout.rects;
+
+        auto reference = acul::make_shared<umbf::Image2D>();
+        reference->width = static_cast<u16>(layout.size.x);
+        reference->height = static_cast<u16>(layout.size.y);
+        reference->format = format;
+        reference->channels = {"R", "G", "B", "A"};
+        umbf::Image2D banded = *reference, blitted = *reference;
+        umbf::fill_atlas_pixels(reference, atlas, sprites);
+        pixels::fill_atlas(banded, *atlas, sprites, 4);
+        pixels::allocate_atlas(blitted);
+        for (size_t i = 0; i < sprites.size(); ++i)
+            pixels::blit_sprite(blitted, *atlas, atlas->pack_data[i], *sprites[i]);
+
+        const size_t size = static_cast<size_t>(reference->width) * reference->height * 4 * bytes_per_channel;
+        const bool same_banded = memcmp(reference->pixels, banded.pixels, size) == 0;
+        const bool same_blitted = memcmp(reference->pixels, blitted.pixels, size) == 0;
+        acul::release(reference->pixels);
+        acul::release(banded.pixels);
+        acul::release(blitted.pixels);
+        for (auto &sprite : sprites) acul::release(sprite->pixels);
+        UNIT_CHECK(same_banded);
+        UNIT_CHECK(same_blitted);
+    }
+    return true;
+}
+
+UNIT_TEST(pixels_image_cache)
+{
+    const acul::string wide = unit::data_path("images/wide.png"), small = unit::data_path("images/small.png");
+    const umbf::ImageFormat f32_format = make_format(umbf::ImageFormat::Type::sfloat, 4);
+    {
+        pixels::ImageCache cache;
+        // Decoded once, however often and from however many threads it is requested
+        acul::shared_ptr<umbf::Image2D> loaded[8];
+        acul::vector<std::thread> threads;
+        for (auto &image : loaded) threads.emplace_back([&] { image = cache.load(wide); });
+        for (auto &thread : threads) thread.join();
+        UNIT_CHECK(loaded[0] && loaded[0]->pixels && loaded[0]->width == 60 && loaded[0]->height == 40);
+        for (const auto &image : loaded) UNIT_CHECK(image == loaded[0]);
+        UNIT_CHECK(cache.load(wide) == loaded[0]);
+
+        // Converted variants are cached per format and leave the decoded source as it was
+        const auto converted = cache.load(small, f32_format, 4);
+        UNIT_CHECK(converted && converted->channels.size() == 4 && !(converted->format != f32_format));
+        UNIT_CHECK(cache.load(small, f32_format, 4) == converted);
+        const auto source = cache.load(small);
+        UNIT_CHECK(source != converted && source->channels.size() == 3 && source->pixels != converted->pixels);
+
+        UNIT_CHECK(!cache.load(unit::data_path("images/missing.png")));
+    }
+
+    // A file replaced during the run is a new entry, keyed by its size and modification time
+    pixels::ImageCache cache;
+    const acul::string copy = unit::output_path("image_cache.png");
+    std::filesystem::copy_file(small.c_str(), copy.c_str(), std::filesystem::copy_options::overwrite_existing);
+    const auto before = cache.load(copy);
+    std::filesystem::copy_file(wide.c_str(), copy.c_str(), std::filesystem::copy_options::overwrite_existing);
+    const auto after = cache.load(copy);
+    UNIT_CHECK(before && after && before != after);
+    UNIT_CHECK(before->width == 16 && after->width == 60);
+    return true;
+}
+
+UNIT_TEST(pixels_atlas_rotate)
+{
+    // Without rotation no side below 120 passes the check, with it two rects stack and the third turns to 40x60
+    const auto wide = make_rects({{60, 40}, {60, 40}, {60, 40}});
+    const pixels::PackMode rotate{umbf::utils::MaxRectsHeuristic::best_short_side_fit,
+                                  umbf::utils::MaxRectsTransformBits::rotate_90};
+    UNIT_CHECK(!pixels::may_fit(wide, 0, 100, false));
+    UNIT_CHECK(pixels::may_fit(wide, 0, 100, true));
+    auto layout = pixels::find_min_square_atlas_size(wide, 0, 1, rotate);
+    UNIT_CHECK(layout.size.x <= 100 && is_valid_layout(wide, layout, 0, true));
+
+    // The same sprites as an atlas built with every heuristic and rotation
+    const acul::string sources[] = {unit::data_path("images/wide.png"), unit::data_path("images/wide.png"),
+                                    unit::data_path("images/wide.png"), unit::data_path("images/tall.png"),
+                                    unit::data_path("images/small.png")};
+    acul::string manifest = R"({ "type": "image", "texture_type": "atlas", "bytesPerChannel": 1, "format": "uint", )"
+                            R"("images": [)";
+    for (size_t i = 0; i < std::size(sources); ++i)
+        manifest += acul::string(i ? ", " : "") + "{ \"path\": \"" + sources[i] + "\" }";
+    manifest += "] }";
+    const acul::string input = unit::output_path("atlas_rotate.json"), output = unit::output_path("atlas_rotate.umbf");
+    FILE *stream = fopen(input.c_str(), "wb");
+    UNIT_CHECK(stream);
+    fwrite(manifest.c_str(), 1, manifest.size(), stream);
+    fclose(stream);
+    JsonOptions options;
+    options.pack_all = true;
+    options.pack_rotate = true;
+    UNIT_CHECK(convert_json(input, output, options) != 0);
+
+    acul::shared_ptr<umbf::File> file;
+    UNIT_CHECK(umbf::File::read_from_disk(output, file).success());
+    acul::vector<acul::shared_ptr<umbf::Image2D>> pages;
+    acul::shared_ptr<umbf::Atlas> atlas;
+    for (const auto &block : file->blocks)
+    {
+        if (block->signature() == umbf::sign_block::image)
+            pages.push_back(acul::static_pointer_cast<umbf::Image2D>(block));
+        else if (block->signature() == umbf::sign_block::image_atlas)
+            atlas = acul::static_pointer_cast<umbf::Atlas>(block);
+    }
+    pixels::SpriteTable table;
+    const bool has_table = pixels::read_sprite_table(*file, table);
+    pixels::AtlasPageTable page_table;
+    const bool paged = pixels::read_page_table(*file, page_table);
+    const acul::shared_ptr<umbf::Image2D> page = pages.empty() ? nullptr : pages.front();
+    auto release_pages = [&] {
+        for (auto &image : pages) acul::release(image->pixels);
+    };
+    // One page, with a rect and a table entry per sprite
+    const bool complete = pages.size() == 1 && atlas && !paged && has_table &&
+                          table.sprites.size() == std::size(sources) && atlas->pack_data.size() == std::size(sources);
+    if (!complete) release_pages();
+    UNIT_CHECK(complete);
+
+    // Every sprite sits at its source size, swapped exactly when the table flags it as rotated, and holds the
+    // source pixels turned the same way
+    pixels::ImageCache cache;
+    acul::vector<amal::irect> input_rects;
+    size_t rotated = 0;
+    bool flags_match = true, pixels_match = true;
+    for (size_t i = 0; i < std::size(sources); ++i)
+    {
+        auto source = cache.load(sources[i], page->format, 4);
+        const amal::irect &rect = atlas->pack_data[i];
+        const pixels::SpriteTrim &sprite = table.sprites[i];
+        input_rects.push_back({{0, 0}, {static_cast<i32>(source->width), static_cast<i32>(source->height)}});
+        const bool is_rotated = sprite.flags & pixels::sprite_rotated;
+        if (is_rotated) ++rotated;
+        flags_match = flags_match && sprite.alias == i && sprite.source_width == source->width &&
+                      sprite.source_height == source->height && is_rotated == pixels::is_rotated(rect, *source);
+        acul::shared_ptr<umbf::Image2D> placed = is_rotated ? pixels::rotate_sprite(*source) : source;
+        const size_t row = static_cast<size_t>(placed->width) * 4;
+        for (u32 y = 0; y < placed->height && pixels_match && rect.size.x == placed->width; ++y)
+        {
+            const u8 *expected = static_cast<const u8 *>(placed->pixels) + y * row;
+            const u8 *actual = static_cast<const u8 *>(page->pixels) +
+                               ((static_cast<size_t>(rect.pos.y) + y) * page->width + rect.pos.x) * 4;
+            pixels_match = memcmp(expected, actual, row) == 0;
+        }
+        if (is_rotated) acul::release(placed->pixels);
+    }
+    pixels::AtlasLayout placed_layout;
+    placed_layout.size = {static_cast<i32>(page->width), static_cast<i32>(page->height)};
+    placed_layout.rects = atlas->pack_data;
+    const bool valid = is_valid_layout(input_rects, placed_layout, atlas->padding, true);
+    release_pages();
+    UNIT_CHECK(valid && flags_match && pixels_match);
+    // The three wide sprites need 124 pixels side by side, so a smaller atlas has turned at least one of them
+    UNIT_CHECK(placed_layout.size.x >= 124 || rotated > 0);
+    return true;
+}
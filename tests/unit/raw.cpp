@@ -0,0 +1,103 @@
+#include <iterator>
+#include "convert.hpp"
+#include "io/mapped_file.hpp"
+#include "raw/aux.hpp"
+#include "raw/borrow.hpp"
+#include "unit.hpp"
+
+UNIT_TEST(raw_borrowed_block)
+{
+    io::MappedFile source;
+    UNIT_CHECK(source.open(unit::data_path("raw/data/table.csv")));
+    const char *mapped = source.data();
+    const size_t size = source.size();
+    acul::shared_ptr<umbf::RawBlock> block;
+    {
+        raw::BorrowedBlocks borrowed;
+        block = borrowed.borrow(std::move(source));
+        // The block reads the mapping itself: no copy of the source exists at any point
+        UNIT_CHECK(block->data == mapped);
+        UNIT_CHECK(block->data_size == size);
+    }
+    // Detached before the mapping went away, so the block never frees or reads unmapped memory
+    UNIT_CHECK(block->data_size == 0);
+    return true;
+}
+
+UNIT_TEST(raw_aux_lookalike_payload)
+{
+    // A payload holding an aux block verbatim, e.g. a dumped manifest packed again as a raw file
+    acul::vector<acul::shared_ptr<umbf::Block>> blocks;
+    blocks.push_back(raw::make_aux_block(raw::aux_tag::manifest, {'m'}));
+    raw::ByteReader reader;
+    UNIT_CHECK(!raw::find_aux_block(blocks, raw::aux_tag::manifest, reader));
+
+    // Once real aux blocks follow, only the ones counted by the trailer are found
+    raw::append_aux_blocks(blocks, {raw::make_aux_block(raw::aux_tag::chunk_table, {'c'})});
+    UNIT_CHECK(blocks.size() == 3);
+    UNIT_CHECK(!raw::find_aux_block(blocks, raw::aux_tag::manifest, reader));
+    UNIT_CHECK(raw::find_aux_block(blocks, raw::aux_tag::chunk_table, reader));
+    UNIT_CHECK(reader.remaining() == 1 && *reader.data() == 'c');
+    return true;
+}
+
+namespace
+{
+    const umbf::Library::Node *find_child(const umbf::Library::Node &parent, const acul::string &name)
+    {
+        const umbf::Library::Node *found = nullptr;
+        for (const auto &child : parent.children)
+        {
+            if (child.name != name) continue;
+            if (found) return nullptr; // Folders and files are unique among their siblings
+            found = &child;
+        }
+        return found;
+    }
+
+    size_t count_files(const umbf::Library::Node &node)
+    {
+        if (!node.is_folder) return 1;
+        size_t count = 0;
+        for (const auto &child : node.children) count += count_files(child);
+        return count;
+    }
+} // namespace
+
+UNIT_TEST(raw_library_tree)
+{
+    RawOptions options;
+    options.recursive = true;
+    const acul::string output = unit::output_path("raw_library_tree.umbf");
+    UNIT_CHECK(convert_raw(unit::data_path("raw"), output, options) != 0);
+    acul::shared_ptr<umbf::File> file;
+    UNIT_CHECK(umbf::File::read_from_disk(output, file).success());
+    const umbf::Library *library = nullptr;
+    for (const auto &block : file->blocks)
+        if (block->signature() == umbf::sign_block::library) library = static_cast<const umbf::Library *>(block.get());
+    UNIT_CHECK(library);
+
+    // Folders appear once, in the order of the sorted input, each holding its files and subfolders
+    const umbf::Library::Node &root = library->file_tree;
+    UNIT_CHECK(count_files(root) == 31);
+    const char *top[] = {"config", "data", "docs", "media", "nested"};
+    UNIT_CHECK(root.children.size() == std::size(top));
+    for (size_t i = 0; i < std::size(top); ++i)
+        UNIT_CHECK(root.children[i].is_folder && root.children[i].name == top[i]);
+    UNIT_CHECK(find_child(root, "config")->children.size() == 24);
+
+    const umbf::Library::Node *docs = find_child(root, "docs");
+    UNIT_CHECK(docs && docs->children.size() == 3);
+    const umbf::Library::Node *copies = find_child(*docs, "copies");
+    UNIT_CHECK(copies && copies->is_folder && find_child(*copies, "readme.txt"));
+    UNIT_CHECK(find_child(*docs, "notes.txt") && find_child(*docs, "readme.txt"));
+
+    const umbf::Library::Node *node = &root;
+    for (const char *part : {"nested", "a", "b", "c"})
+    {
+        node = find_child(*node, part);
+        UNIT_CHECK(node && node->is_folder && node->children.size() == 1);
+    }
+    UNIT_CHECK(!node->children.front().is_folder && node->children.front().name == "deep.txt");
+    return true;
+}
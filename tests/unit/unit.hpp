@@ -0,0 +1,42 @@
+#pragma once
+#include <acul/string/string.hpp>
+#include <cstdio>
+
+// Minimal registry of the unit tests. Every UNIT_TEST registers itself and the runner executes the one named on its
+// command line, so each case is a separate ctest entry.
+namespace unit
+{
+    struct Test
+    {
+        const char *name;
+        bool (*run)();
+    };
+
+    acul::vector<Test> &tests();
+
+    struct Registrar
+    {
+        Registrar(const char *name, bool (*run)()) { tests().push_back({name, run}); }
+    };
+
+    // Checked-in fixture under tests/data
+    acul::string data_path(const acul::string &relative);
+
+    // Scratch file or directory of the test run
+    acul::string output_path(const acul::string &relative);
+} // namespace unit
+
+#define UNIT_TEST(name)                                         \
+    static bool name();                                         \
+    static const unit::Registrar name##_registrar(#name, name); \
+    static bool name()
+
+#define UNIT_CHECK(condition)                                                             \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return false;                                                                 \
+        }                                                                                 \
+    } while (0)